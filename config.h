@@ -0,0 +1,74 @@
+#ifndef __CONFIG_H_
+#define __CONFIG_H_
+
+/*
+ * config.h - malloc lab configuration file
+ *
+ * Copyright (c) 2002, R. Bryant and D. O'Hallaron, All rights reserved.
+ * May not be used, modified, or copied without permission.
+ */
+
+/*
+ * This is the default path where the driver will look for the
+ * default tracefiles. You can override it at runtime with the -t flag.
+ */
+#define TRACEDIR "./traces/"
+
+/*
+ * This is the list of default tracefiles in TRACEDIR that the driver
+ * will use for testing. Modify this if you want to add or delete
+ * traces from the driver's test suite. "make traces" generates these
+ * with tracegen from fixed seeds, so they are the same everywhere;
+ * between them they cover each size distribution, lifetime policy and
+ * realloc growth pattern tracegen has.
+ */
+#define DEFAULT_TRACEFILES \
+  "gen-fixed-lifo.rep",\
+  "gen-uniform-fifo.rep",\
+  "gen-power-random.rep",\
+  "gen-bimodal-random.rep",\
+  "gen-background.rep",\
+  "gen-realloc-geometric.rep",\
+  "gen-realloc-linear.rep",\
+  "gen-mixed-large.rep"
+
+/*
+ * This constant gives the estimated performance of the libc malloc
+ * package using our traces on some reference system, typically the
+ * same kind of system the students use. Its purpose is to cap the
+ * contribution of throughput to the performance index. Once the
+ * students surpass the AVG_LIBC_THRUPUT, they get no further benefit
+ * to their score.  This deters students from building extremely fast,
+ * but extremely stupid malloc packages.
+ */
+#define AVG_LIBC_THRUPUT      12176E3  /* 600 Kops/sec */
+
+ /* 
+  * This constant determines the contributions of space utilization
+  * (UTIL_WEIGHT) and throughput (1 - UTIL_WEIGHT) to the performance
+  * index.  
+  */
+#define UTIL_WEIGHT .60
+
+/* 
+ * Alignment requirement in bytes (either 4 or 8) 
+ */
+#define ALIGNMENT 8  
+
+/* 
+ * Maximum heap size in bytes.  memlib only reserves the address space
+ * up front, so this can be set well past physical memory with
+ * -DMAX_HEAP=...  A heap past 4 GB needs mm.c built with -DWIDE_HEADERS=1.
+ */
+#ifndef MAX_HEAP
+#define MAX_HEAP ((size_t)20 << 20)  /* 20 MB */
+#endif
+
+/*****************************************************************************
+ * Set exactly one of these USE_xxx constants to "1" to select a timing method
+ *****************************************************************************/
+#define USE_FCYC   0   /* cycle counter w/K-best scheme (x86 & Alpha only) */
+#define USE_ITIMER 0   /* interval timer (any Unix box) */
+#define USE_GETTOD 1   /* gettimeofday (any Unix box) */
+
+#endif /* __CONFIG_H */
@@ -0,0 +1,2124 @@
+/*
+ * mdriver.c - CS:APP Malloc Lab Driver
+ * 
+ * Uses a collection of trace files to tests a malloc/free/realloc
+ * implementation in mm.c.
+ *
+ * Copyright (c) 2002, R. Bryant and D. O'Hallaron, All rights reserved.
+ * May not be used, modified, or copied without permission.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <assert.h>
+#include <float.h>
+#include <time.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "mm.h"
+#include "memlib.h"
+#include "fsecs.h"
+#include "config.h"
+#include "mmlog.h"
+#include "tracebin.h"
+
+/**********************
+ * Constants and macros
+ **********************/
+
+/* Misc */
+#define MAXLINE     1024 /* max string size */
+#define HDRLINES       4 /* number of header lines in a trace file */
+#define LINENUM(i) (i+5) /* cnvt trace request nums to linenums (origin 1) */
+#define LOGTRACE    (-1) /* tracenum for errors in a binary log */
+#define LOGBUF      4096 /* log records read at a time */
+
+/* Latency histograms (-L) */
+#define HIST_SUB_BITS 4  /* 2^HIST_SUB_BITS buckets per power of two */
+#define HIST_SUB      (1 << HIST_SUB_BITS)
+#define HIST_BUCKETS  ((64 - HIST_SUB_BITS + 1) << HIST_SUB_BITS)
+#define NUM_SIZE_CLASSES 8 /* <=16, <=64, ... <=64K, larger */
+
+/* Returns true if p is ALIGNMENT-byte aligned */
+#define IS_ALIGNED(p)  ((((unsigned int)(p)) % ALIGNMENT) == 0)
+
+/****************************** 
+ * The key compound data types 
+ *****************************/
+
+/* Records the extent of each block's payload, as a node of an AVL tree ordered by address */
+typedef struct range_t {
+    char *lo;               /* low payload address */
+    char *hi;               /* high payload address */
+    struct range_t *left;   /* ranges below this one */
+    struct range_t *right;  /* ranges above this one */
+    int height;             /* height of the subtree rooted here */
+} range_t;
+
+/* Holds the information for one trace file*/
+typedef struct {
+    int sugg_heapsize;   /* suggested heap size (unused) */
+    int num_ids;         /* number of alloc/realloc ids */
+    int num_ops;         /* number of distinct requests */
+    int weight;          /* weight for this trace (unused) */
+    traceop_t *ops;      /* array of requests */
+    char **blocks;       /* array of ptrs returned by malloc/realloc... */
+    size_t *block_sizes; /* ... and a corresponding array of payload sizes */
+    void *map;           /* mapping of a binary trace holding ops, or NULL */
+    size_t mapsize;      /* its size in bytes */
+} trace_t;
+
+/* 
+ * Holds the params to the xxx_speed functions, which are timed by fcyc. 
+ * This struct is necessary because fcyc accepts only a pointer array
+ * as input.
+ */
+typedef struct {
+    trace_t *trace;  
+    range_t *ranges;
+} speed_t;
+
+/* Log-linear histogram of latencies in nanoseconds */
+typedef struct {
+    uint64_t count;                 /* values counted */
+    uint64_t max;                   /* largest of them */
+    double sum;                     /* their sum */
+    uint64_t buckets[HIST_BUCKETS]; /* see hist_index */
+} hist_t;
+
+/* Latencies of the calls into the mm package on one trace */
+enum {LAT_MALLOC, LAT_FREE, LAT_REALLOC, NUM_LAT_OPS};
+typedef struct {
+    hist_t hists[NUM_LAT_OPS][NUM_SIZE_CLASSES];
+} latency_t;
+
+/* Streams the records of a binary log */
+typedef struct {
+    FILE *file;
+    char *name;
+    mmlog_rec_t buf[LOGBUF]; /* records read ahead */
+    size_t n;                /* number of records in buf */
+    size_t next;             /* next of them to hand out */
+    long recnum;             /* number of the record last handed out */
+} logreader_t;
+
+/* A slot of the table of the live blocks of a log being replayed */
+typedef struct {
+    uint64_t key;   /* address the traced program saw, 0 in an empty slot */
+    int id;         /* id of the block there */
+} logslot_t;
+
+/* Open-addressed hash table of the live blocks of a log being replayed */
+typedef struct {
+    logslot_t *slots;
+    size_t mask;    /* number of slots - 1 */
+    size_t count;   /* number of slots in use */
+} blockmap_t;
+
+#define BLOCKHASH(key, mask) ((size_t)((((key) >> 4) * 0x9e3779b97f4a7c15ULL) >> 24) & (mask))
+
+/* A request read from a log, with the block it concerns given by id */
+typedef struct {
+    unsigned char type;  /* MMLOG_MALLOC ... MMLOG_FREE */
+    unsigned char align; /* log2 of the alignment of an MMLOG_MEMALIGN */
+    int id;              /* block allocated, resized or freed */
+    size_t size;         /* bytes requested */
+    long recnum;         /* record of the log the request came from */
+} logop_t;
+
+/* A block of a replayed log */
+typedef struct {
+    char *p;        /* block mm_malloc returned, NULL when not live */
+    size_t size;    /* payload size */
+    int fill;       /* byte the payload was filled with */
+} logblock_t;
+
+/* Holds a binary log being replayed, and the state of the replay */
+typedef struct {
+    logreader_t log;     /* the log, streamed once per replay */
+    blockmap_t map;      /* ids of the live blocks by address */
+    int *free_ids;       /* ids of freed blocks... */
+    long num_free;       /* ... how many... */
+    long max_free;       /* ... and room for */
+    logop_t ops[2 * LOGBUF]; /* requests of the records read last */
+    long num_ops;        /* number of them */
+    long total_ops;      /* requests replayed so far */
+    logblock_t *blocks;  /* live blocks by id */
+    long num_ids;        /* number of ids handed out... */
+    long max_ids;        /* ... and room for */
+    range_t *ranges;     /* payload extents, when checking */
+    latency_t *lat;      /* latencies, when timing each call */
+    uint64_t ns;         /* nanoseconds spent replaying requests */
+    size_t live;         /* payload bytes allocated now... */
+    size_t peak;         /* ... and at most */
+} replay_t;
+
+/* Summarizes the important stats for some malloc function on some trace */
+typedef struct {
+    /* defined for both libc malloc and student malloc package (mm.c) */
+    double ops;      /* number of ops (malloc/free/realloc) in the trace */
+    int valid;       /* was the trace processed correctly by the allocator? */
+    double secs;     /* number of secs needed to run the trace */
+
+    /* defined only for the student malloc package */
+    double util;     /* space utilization for this trace (always 0 for libc) */
+
+    /* Note: secs and util are only defined if valid is true */
+} stats_t; 
+
+/********************
+ * Global variables
+ *******************/
+int verbose = 0;        /* global flag for verbose output */
+static int errors = 0;  /* number of errs found when running student malloc */
+char msg[MAXLINE];      /* for whenever we need to compose an error message */
+
+/* Directory where default tracefiles are found */
+static char tracedir[MAXLINE] = TRACEDIR;
+
+/* The filenames of the default tracefiles */
+static char *default_tracefiles[] = {  
+    DEFAULT_TRACEFILES, NULL
+};
+
+
+/********************* 
+ * Function prototypes 
+ *********************/
+
+/* these functions manipulate range trees */
+static int add_range(range_t **ranges, char *lo, size_t size, 
+		     int tracenum, long opnum);
+static void remove_range(range_t **ranges, char *lo);
+static void clear_ranges(range_t **ranges);
+
+/* These functions read, allocate, and free storage for traces */
+static trace_t *read_trace(char *tracedir, char *filename);
+static void map_trace(trace_t *trace, FILE *tracefile, char *path);
+static void free_trace(trace_t *trace);
+
+/* These functions replay binary logs captured by mmtrace.so */
+static void open_log(logreader_t *log, char *filename);
+static void rewind_log(logreader_t *log);
+static mmlog_rec_t *next_record(logreader_t *log);
+static long read_ops(replay_t *rp);
+static int replay_log(replay_t *rp, int check);
+static void free_live(replay_t *rp);
+static void eval_log(char *filename, stats_t *stats, latency_t *lat);
+
+/* These functions record the latency of single calls (-L) */
+static uint64_t now_ns(void);
+static void record_latency(latency_t *lat, int op, size_t size, uint64_t ns);
+
+/* Routines for evaluating the correctness and speed of libc malloc */
+static int eval_libc_valid(trace_t *trace, int tracenum);
+static void eval_libc_speed(void *ptr);
+
+/* Routines for evaluating correctnes, space utilization, and speed 
+   of the student's malloc package in mm.c */
+static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges);
+static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges);
+static void eval_mm_speed(void *ptr);
+static void eval_mm_latency(trace_t *trace, latency_t *lat);
+
+/* Various helper routines */
+static void printresults(int n, stats_t *stats);
+static void printlatency(int n, latency_t *lat);
+static void writelatency(char *filename, int n, latency_t *lat);
+static void usage(void);
+static void unix_error(char *msg);
+static void malloc_error(int tracenum, long opnum, char *msg);
+static void app_error(char *msg);
+
+/**************
+ * Main routine
+ **************/
+int main(int argc, char **argv)
+{
+    int i;
+    char c;
+    char **tracefiles = NULL;  /* null-terminated array of trace file names */
+    char *logfile = NULL;      /* binary log to replay instead (-r) */
+    char *csvfile = NULL;      /* file for the latencies as CSV (-c) */
+    latency_t *lat = NULL;     /* latencies for each trace (-L) */
+    int num_tracefiles = 0;    /* the number of traces in that array */
+    trace_t *trace = NULL;     /* stores a single trace file in memory */
+    range_t *ranges = NULL;    /* keeps track of block extents for one trace */
+    stats_t *libc_stats = NULL;/* libc stats for each trace */
+    stats_t *mm_stats = NULL;  /* mm (i.e. student) stats for each trace */
+    speed_t speed_params;      /* input parameters to the xx_speed routines */ 
+
+    int team_check = 1;  /* If set, check team structure (reset by -a) */
+    int run_libc = 0;    /* If set, run libc malloc (set by -l) */
+    int autograder = 0;  /* If set, emit summary info for autograder (-g) */
+    int latency = 0;     /* If set, time every call on its own (set by -L) */
+
+    /* temporaries used to compute the performance index */
+    double secs, ops, util, avg_mm_util, avg_mm_throughput, p1, p2, perfindex;
+    int numcorrect;
+    
+    /* 
+     * Read and interpret the command line arguments 
+     */
+    while ((c = getopt(argc, argv, "f:r:t:c:hvVgalL")) != EOF) {
+        switch (c) {
+	case 'g': /* Generate summary info for the autograder */
+	    autograder = 1;
+	    break;
+        case 'f': /* Use one specific trace file only (relative to curr dir) */
+            num_tracefiles = 1;
+            if ((tracefiles = realloc(tracefiles, 2*sizeof(char *))) == NULL)
+		unix_error("ERROR: realloc failed in main");
+	    strcpy(tracedir, "./"); 
+            tracefiles[0] = strdup(optarg);
+            tracefiles[1] = NULL;
+            break;
+	case 'r': /* Replay a binary log captured with mmtrace.so */
+	    logfile = strdup(optarg);
+	    break;
+	case 't': /* Directory where the traces are located */
+	    if (num_tracefiles == 1) /* ignore if -f already encountered */
+		break;
+	    strcpy(tracedir, optarg);
+	    if (tracedir[strlen(tracedir)-1] != '/') 
+		strcat(tracedir, "/"); /* path always ends with "/" */
+	    break;
+        case 'a': /* Don't check team structure */
+            team_check = 0;
+            break;
+        case 'l': /* Run libc malloc */
+            run_libc = 1;
+            break;
+        case 'L': /* Report the latency of every call */
+            latency = 1;
+            break;
+	case 'c': /* Write the latencies as CSV too */
+	    latency = 1;
+	    csvfile = strdup(optarg);
+	    break;
+        case 'v': /* Print per-trace performance breakdown */
+            verbose = 1;
+            break;
+        case 'V': /* Be more verbose than -v */
+            verbose = 2;
+            break;
+        case 'h': /* Print this message */
+	    usage();
+            exit(0);
+        default:
+	    usage();
+            exit(1);
+        }
+    }
+	
+    /* 
+     * Check and print team info 
+     */
+    if (team_check) {
+	/* Students must fill in their team information */
+	if (!strcmp(team.teamname, "")) {
+	    printf("ERROR: Please provide the information about your team in mm.c.\n");
+	    exit(1);
+	} else
+	    printf("Team Name:%s\n", team.teamname);
+	if ((*team.name1 == '\0') || (*team.id1 == '\0')) {
+	    printf("ERROR.  You must fill in all team member 1 fields!\n");
+	    exit(1);
+	} 
+	else
+	    printf("Member 1 :%s:%s\n", team.name1, team.id1);
+
+	if (((*team.name2 != '\0') && (*team.id2 == '\0')) ||
+	    ((*team.name2 == '\0') && (*team.id2 != '\0'))) { 
+	    printf("ERROR.  You must fill in all or none of the team member 2 ID fields!\n");
+	    exit(1);
+	}
+	else if (*team.name2 != '\0')
+	    printf("Member 2 :%s:%s\n", team.name2, team.id2);
+    }
+
+    /* 
+     * If no -f command line arg, then use the entire set of tracefiles 
+     * defined in default_traces[]
+     */
+    if (tracefiles == NULL && logfile == NULL) {
+        tracefiles = default_tracefiles;
+        num_tracefiles = sizeof(default_tracefiles) / sizeof(char *) - 1;
+	printf("Using default tracefiles in %s\n", tracedir);
+    }
+
+    /* Initialize the timing package */
+    init_fsecs();
+
+    /*
+     * Replaying a binary log replaces the traces and the performance index
+     */
+    if (logfile != NULL) {
+	stats_t log_stats;
+
+	memset(&log_stats, 0, sizeof(log_stats));
+	if (latency && (lat = (latency_t *)calloc(1, sizeof(latency_t))) == NULL)
+	    unix_error("lat calloc in main failed");
+	mem_init();
+	eval_log(logfile, &log_stats, lat);
+	printf("\nResults for mm malloc on %s:\n", logfile);
+	printresults(1, &log_stats);
+	if (lat != NULL && log_stats.valid) {
+	    printlatency(1, lat);
+	    if (csvfile != NULL)
+		writelatency(csvfile, 1, lat);
+	}
+	if (errors) {
+	    printf("Terminated with %d errors\n", errors);
+	    exit(1);
+	}
+	exit(0);
+    }
+
+    /*
+     * Optionally run and evaluate the libc malloc package 
+     */
+    if (run_libc) {
+	if (verbose > 1)
+	    printf("\nTesting libc malloc\n");
+	
+	/* Allocate libc stats array, with one stats_t struct per tracefile */
+	libc_stats = (stats_t *)calloc(num_tracefiles, sizeof(stats_t));
+	if (libc_stats == NULL)
+	    unix_error("libc_stats calloc in main failed");
+	
+	/* Evaluate the libc malloc package using the K-best scheme */
+	for (i=0; i < num_tracefiles; i++) {
+	    trace = read_trace(tracedir, tracefiles[i]);
+	    libc_stats[i].ops = trace->num_ops;
+	    if (verbose > 1)
+		printf("Checking libc malloc for correctness, ");
+	    libc_stats[i].valid = eval_libc_valid(trace, i);
+	    if (libc_stats[i].valid) {
+		speed_params.trace = trace;
+		if (verbose > 1)
+		    printf("and performance.\n");
+		libc_stats[i].secs = fsecs(eval_libc_speed, &speed_params);
+	    }
+	    free_trace(trace);
+	}
+
+	/* Display the libc results in a compact table */
+	if (verbose) {
+	    printf("\nResults for libc malloc:\n");
+	    printresults(num_tracefiles, libc_stats);
+	}
+    }
+
+    /*
+     * Always run and evaluate the student's mm package
+     */
+    if (verbose > 1)
+	printf("\nTesting mm malloc\n");
+
+    /* Allocate the mm stats array, with one stats_t struct per tracefile */
+    mm_stats = (stats_t *)calloc(num_tracefiles, sizeof(stats_t));
+    if (mm_stats == NULL)
+	unix_error("mm_stats calloc in main failed");
+    
+    /* ... and a latency_t struct per tracefile if asked for */
+    if (latency &&
+	(lat = (latency_t *)calloc(num_tracefiles, sizeof(latency_t))) == NULL)
+	unix_error("lat calloc in main failed");
+
+    /* Initialize the simulated memory system in memlib.c */
+    mem_init(); 
+
+    /* Evaluate student's mm malloc package using the K-best scheme */
+    for (i=0; i < num_tracefiles; i++) {
+	trace = read_trace(tracedir, tracefiles[i]);
+	mm_stats[i].ops = trace->num_ops;
+	if (verbose > 1)
+	    printf("Checking mm_malloc for correctness, ");
+	mm_stats[i].valid = eval_mm_valid(trace, i, &ranges);
+	if (mm_stats[i].valid) {
+	    if (verbose > 1)
+		printf("efficiency, ");
+	    mm_stats[i].util = eval_mm_util(trace, i, &ranges);
+	    speed_params.trace = trace;
+	    speed_params.ranges = ranges;
+	    if (verbose > 1)
+		printf("and performance.\n");
+	    mm_stats[i].secs = fsecs(eval_mm_speed, &speed_params);
+	    if (lat != NULL)
+		eval_mm_latency(trace, &lat[i]);
+	}
+	free_trace(trace);
+    }
+
+    /* Display the mm results in a compact table */
+    if (verbose) {
+	printf("\nResults for mm malloc:\n");
+	printresults(num_tracefiles, mm_stats);
+	printf("\n");
+    }
+
+    /* Display the latencies after it, and write them out as CSV */
+    if (lat != NULL) {
+	printlatency(num_tracefiles, lat);
+	printf("\n");
+	if (csvfile != NULL)
+	    writelatency(csvfile, num_tracefiles, lat);
+    }
+
+    /* 
+     * Accumulate the aggregate statistics for the student's mm package 
+     */
+    secs = 0;
+    ops = 0;
+    util = 0;
+    numcorrect = 0;
+    for (i=0; i < num_tracefiles; i++) {
+	secs += mm_stats[i].secs;
+	ops += mm_stats[i].ops;
+	util += mm_stats[i].util;
+	if (mm_stats[i].valid)
+	    numcorrect++;
+    }
+    avg_mm_util = util/num_tracefiles;
+
+    /* 
+     * Compute and print the performance index 
+     */
+    if (errors == 0) {
+	avg_mm_throughput = ops/secs;
+
+	p1 = UTIL_WEIGHT * avg_mm_util;
+	if (avg_mm_throughput > AVG_LIBC_THRUPUT) {
+	    p2 = (double)(1.0 - UTIL_WEIGHT);
+	} 
+	else {
+	    p2 = ((double) (1.0 - UTIL_WEIGHT)) * 
+		(avg_mm_throughput/AVG_LIBC_THRUPUT);
+	}
+	
+	perfindex = (p1 + p2)*100.0;
+	printf("Perf index = %.0f (util) + %.0f (thru) = %.0f/100\n",
+	       p1*100, 
+	       p2*100, 
+	       perfindex);
+	
+    }
+    else { /* There were errors */
+	perfindex = 0.0;
+	printf("Terminated with %d errors\n", errors);
+    }
+
+    if (autograder) {
+	printf("correct:%d\n", numcorrect);
+	printf("perfidx:%.0f\n", perfindex);
+    }
+
+    exit(0);
+}
+
+
+/*****************************************************************
+ * The following routines manipulate the range tree, which keeps 
+ * track of the extent of every allocated block payload. We use the 
+ * range tree to detect any overlapping allocated blocks. It is an
+ * AVL tree ordered by payload address, so checking, adding and
+ * removing a block take O(log n) even for traces with millions of
+ * live blocks.
+ ****************************************************************/
+
+/* Height of a possibly empty subtree */
+#define HEIGHT(p) ((p) ? (p)->height : 0)
+
+/*
+ * fix_height - Recompute the height of p from its children
+ */
+static void fix_height(range_t *p)
+{
+    int hl = HEIGHT(p->left), hr = HEIGHT(p->right);
+    p->height = (hl > hr ? hl : hr) + 1;
+}
+
+/*
+ * rotate - Rotate the child of p on side dir (0 left, 1 right) up into
+ *     p's place and return it
+ */
+static range_t *rotate(range_t *p, int dir)
+{
+    range_t *q;
+
+    if (dir == 0) {
+        q = p->left;
+        p->left = q->right;
+        q->right = p;
+    }
+    else {
+        q = p->right;
+        p->right = q->left;
+        q->left = p;
+    }
+    fix_height(p);
+    fix_height(q);
+    return q;
+}
+
+/*
+ * rebalance - Restore the AVL property at p after one of its subtrees
+ *     changed height by one, and return the new root of the subtree
+ */
+static range_t *rebalance(range_t *p)
+{
+    int balance = HEIGHT(p->left) - HEIGHT(p->right);
+
+    if (balance > 1) {
+        if (HEIGHT(p->left->left) < HEIGHT(p->left->right))
+            p->left = rotate(p->left, 1);
+        return rotate(p, 0);
+    }
+    if (balance < -1) {
+        if (HEIGHT(p->right->right) < HEIGHT(p->right->left))
+            p->right = rotate(p->right, 0);
+        return rotate(p, 1);
+    }
+    fix_height(p);
+    return p;
+}
+
+/*
+ * insert_range - Insert node r into the subtree rooted at p and return
+ *     the new root of the subtree
+ */
+static range_t *insert_range(range_t *p, range_t *r)
+{
+    if (p == NULL)
+        return r;
+    if (r->lo < p->lo)
+        p->left = insert_range(p->left, r);
+    else
+        p->right = insert_range(p->right, r);
+    return rebalance(p);
+}
+
+/*
+ * delete_range - Unlink the node whose payload starts at lo from the
+ *     subtree rooted at p and return the new root of the subtree. The
+ *     unlinked node, if any, is left in *found.
+ */
+static range_t *delete_range(range_t *p, char *lo, range_t **found)
+{
+    range_t *succ;
+
+    if (p == NULL)
+        return NULL;
+    if (lo < p->lo)
+        p->left = delete_range(p->left, lo, found);
+    else if (lo > p->lo)
+        p->right = delete_range(p->right, lo, found);
+    else {
+        *found = p;
+        if (p->left == NULL || p->right == NULL)
+            return p->left ? p->left : p->right;
+        /* Put the lowest node of the right subtree in p's place */
+        for (succ = p->right; succ->left != NULL; succ = succ->left)
+            ;
+        succ->right = delete_range(p->right, succ->lo, &succ);
+        succ->left = p->left;
+        p = succ;
+    }
+    return rebalance(p);
+}
+
+/*
+ * add_range - As directed by request opnum in trace tracenum,
+ *     we've just called the student's mm_malloc to allocate a block of 
+ *     size bytes at addr lo. After checking the block for correctness,
+ *     we create a range struct for this block and add it to the range tree. 
+ */
+static int add_range(range_t **ranges, char *lo, size_t size, 
+		     int tracenum, long opnum)
+{
+    char *hi = lo + size - 1;
+    range_t *p, *pred;
+    char msg[MAXLINE];
+
+    assert(size > 0);
+
+    /* Payload addresses must be ALIGNMENT-byte aligned */
+    if (!IS_ALIGNED(lo)) {
+	sprintf(msg, "Payload address (%p) not aligned to %d bytes", 
+		lo, ALIGNMENT);
+        malloc_error(tracenum, opnum, msg);
+        return 0;
+    }
+
+    /* The payload must lie within the extent of the heap or of a mapping */
+    if (((lo < (char *)mem_heap_lo()) || (lo > (char *)mem_heap_hi()) || 
+	 (hi < (char *)mem_heap_lo()) || (hi > (char *)mem_heap_hi())) &&
+	!mem_is_mapped(lo, hi)) {
+	sprintf(msg, "Payload (%p:%p) lies outside heap (%p:%p)",
+		lo, hi, mem_heap_lo(), mem_heap_hi());
+	malloc_error(tracenum, opnum, msg);
+        return 0;
+    }
+
+    /* 
+     * The payload must not overlap any other payloads. The payloads in
+     * the tree are disjoint, so the only one that can overlap [lo, hi]
+     * is the one starting closest below or at hi.
+     */
+    pred = NULL;
+    for (p = *ranges;  p != NULL;  ) {
+        if (p->lo <= hi) {
+            pred = p;
+            p = p->right;
+        }
+        else
+            p = p->left;
+    }
+    if (pred != NULL && pred->hi >= lo) {
+	sprintf(msg, "Payload (%p:%p) overlaps another payload (%p:%p)\n",
+		lo, hi, pred->lo, pred->hi);
+	malloc_error(tracenum, opnum, msg);
+	return 0;
+    }
+
+    /* 
+     * Everything looks OK, so remember the extent of this block 
+     * by creating a range struct and adding it the range tree.
+     */
+    if ((p = (range_t *)malloc(sizeof(range_t))) == NULL)
+	unix_error("malloc error in add_range");
+    p->lo = lo;
+    p->hi = hi;
+    p->left = p->right = NULL;
+    p->height = 1;
+    *ranges = insert_range(*ranges, p);
+    return 1;
+}
+
+/* 
+ * remove_range - Free the range record of block whose payload starts at lo 
+ */
+static void remove_range(range_t **ranges, char *lo)
+{
+    range_t *p = NULL;
+
+    *ranges = delete_range(*ranges, lo, &p);
+    free(p);
+}
+
+/*
+ * free_ranges - free the range records in the subtree rooted at p
+ */
+static void free_ranges(range_t *p)
+{
+    if (p != NULL) {
+        free_ranges(p->left);
+        free_ranges(p->right);
+        free(p);
+    }
+}
+
+/*
+ * clear_ranges - free all of the range records for a trace 
+ */
+static void clear_ranges(range_t **ranges)
+{
+    free_ranges(*ranges);
+    *ranges = NULL;
+}
+
+
+/**********************************************
+ * The following routines manipulate tracefiles
+ *********************************************/
+
+/*
+ * read_trace - read a trace file and store it in memory.  A binary
+ *     trace written by rep2bin is mapped instead of parsed.
+ */
+static trace_t *read_trace(char *tracedir, char *filename)
+{
+    FILE *tracefile;
+    trace_t *trace;
+    char type[MAXLINE];
+    char path[MAXLINE];
+    unsigned index, size;
+    unsigned max_index = 0;
+    unsigned op_index;
+    char magic[sizeof(TRACEBIN_MAGIC) - 1];
+
+    if (verbose > 1)
+	printf("Reading tracefile: %s\n", filename);
+
+    /* Allocate the trace record */
+    if ((trace = (trace_t *) malloc(sizeof(trace_t))) == NULL)
+	unix_error("malloc 1 failed in read_trance");
+	
+    /* Read the trace file header */
+    strcpy(path, tracedir);
+    strcat(path, filename);
+    if ((tracefile = fopen(path, "r")) == NULL) {
+	sprintf(msg, "Could not open %s in read_trace", path);
+	unix_error(msg);
+    }
+    if (fread(magic, sizeof(magic), 1, tracefile) == 1 &&
+	memcmp(magic, TRACEBIN_MAGIC, sizeof(magic)) == 0)
+	map_trace(trace, tracefile, path);
+    else {
+	rewind(tracefile);
+	trace->map = NULL;
+	fscanf(tracefile, "%d", &(trace->sugg_heapsize)); /* not used */
+	fscanf(tracefile, "%d", &(trace->num_ids));     
+	fscanf(tracefile, "%d", &(trace->num_ops));     
+	fscanf(tracefile, "%d", &(trace->weight));        /* not used */
+
+	/* We'll store each request line in the trace in this array */
+	if ((trace->ops = 
+	     (traceop_t *)malloc(trace->num_ops * sizeof(traceop_t))) == NULL)
+	    unix_error("malloc 2 failed in read_trace");
+    }
+
+    /* We'll keep an array of pointers to the allocated blocks here... */
+    if ((trace->blocks = 
+	 (char **)malloc(trace->num_ids * sizeof(char *))) == NULL)
+	unix_error("malloc 3 failed in read_trace");
+
+    /* ... along with the corresponding byte sizes of each block */
+    if ((trace->block_sizes = 
+	 (size_t *)malloc(trace->num_ids * sizeof(size_t))) == NULL)
+	unix_error("malloc 4 failed in read_trace");
+
+    /* The ops of a binary trace are ready to use where they lie */
+    if (trace->map != NULL) {
+	fclose(tracefile);
+	return trace;
+    }
+    
+    /* read every request line in the trace file */
+    index = 0;
+    op_index = 0;
+    while (fscanf(tracefile, "%s", type) != EOF) {
+	switch(type[0]) {
+	case 'a':
+	    fscanf(tracefile, "%u %u", &index, &size);
+	    trace->ops[op_index].type = ALLOC;
+	    trace->ops[op_index].index = index;
+	    trace->ops[op_index].size = size;
+	    max_index = (index > max_index) ? index : max_index;
+	    break;
+	case 'r':
+	    fscanf(tracefile, "%u %u", &index, &size);
+	    trace->ops[op_index].type = REALLOC;
+	    trace->ops[op_index].index = index;
+	    trace->ops[op_index].size = size;
+	    max_index = (index > max_index) ? index : max_index;
+	    break;
+	case 'f':
+	    fscanf(tracefile, "%ud", &index);
+	    trace->ops[op_index].type = FREE;
+	    trace->ops[op_index].index = index;
+	    break;
+	default:
+	    printf("Bogus type character (%c) in tracefile %s\n", 
+		   type[0], path);
+	    exit(1);
+	}
+	op_index++;
+	
+    }
+    fclose(tracefile);
+    assert(max_index == trace->num_ids - 1);
+    assert(trace->num_ops == op_index);
+    
+    return trace;
+}
+
+/*
+ * map_trace - map the binary trace open as tracefile, check its ops
+ *     and point trace->ops at them
+ */
+static void map_trace(trace_t *trace, FILE *tracefile, char *path)
+{
+    tracebin_hdr_t hdr;
+    struct stat st;
+    traceop_t *op;
+    int i;
+
+    rewind(tracefile);
+    if (fread(&hdr, sizeof(hdr), 1, tracefile) != 1 ||
+	hdr.version != TRACEBIN_VERSION || hdr.opsize != sizeof(traceop_t)) {
+	printf("%s is not a version %d binary trace\n", path, TRACEBIN_VERSION);
+	exit(1);
+    }
+    if (fstat(fileno(tracefile), &st) < 0)
+	unix_error("fstat failed in map_trace");
+    if (hdr.num_ops < 0 || hdr.num_ids < 0 || st.st_size < (off_t)sizeof(hdr) ||
+	(uint64_t)(st.st_size - sizeof(hdr)) / sizeof(traceop_t) < (uint64_t)hdr.num_ops) {
+	printf("Binary trace %s is truncated\n", path);
+	exit(1);
+    }
+
+    trace->mapsize = st.st_size;
+    trace->map = mmap(NULL, trace->mapsize, PROT_READ, MAP_PRIVATE, 
+		      fileno(tracefile), 0);
+    if (trace->map == MAP_FAILED)
+	unix_error("mmap failed in map_trace");
+    trace->ops = (traceop_t *)((char *)trace->map + sizeof(hdr));
+
+    /* Check every op once here, since the evaluation trusts them */
+    for (i = 0; i < hdr.num_ops; i++) {
+	op = &trace->ops[i];
+	if ((op->type != ALLOC && op->type != FREE && op->type != REALLOC) ||
+	    op->index < 0 || op->index >= hdr.num_ids || op->size < 0) {
+	    printf("Bogus request %d in binary trace %s\n", i, path);
+	    exit(1);
+	}
+    }
+
+    trace->sugg_heapsize = hdr.sugg_heapsize;
+    trace->num_ids = hdr.num_ids;
+    trace->num_ops = hdr.num_ops;
+    trace->weight = hdr.weight;
+}
+
+/*
+ * free_trace - Free the trace record and the three arrays it points
+ *              to, all of which were allocated in read_trace().  The
+ *              ops of a binary trace are unmapped instead.
+ */
+void free_trace(trace_t *trace)
+{
+    if (trace->map != NULL)   /* free the three arrays... */
+	munmap(trace->map, trace->mapsize);
+    else
+	free(trace->ops);
+    free(trace->blocks);      
+    free(trace->block_sizes);
+    free(trace);              /* and the trace record itself... */
+}
+
+/**********************************************************************
+ * The following routines record the latency of single calls into the
+ * mm package (-L).  Each call is timed with clock_gettime and counted
+ * in a log-linear histogram: a bucket per value below 2^HIST_SUB_BITS,
+ * then 2^HIST_SUB_BITS buckets per power of two, so every percentile
+ * is within 1/2^HIST_SUB_BITS of the true value.
+ **********************************************************************/
+
+/*
+ * now_ns - Read the monotonic clock in nanoseconds
+ */
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/*
+ * timer_overhead - Smallest time two back to back reads of the clock
+ *     report, which is included in every latency
+ */
+static uint64_t timer_overhead(void)
+{
+    uint64_t t, min = UINT64_MAX;
+    int i;
+
+    for (i = 0; i < 1000; i++) {
+	t = now_ns();
+	t = now_ns() - t;
+	if (t < min)
+	    min = t;
+    }
+    return min;
+}
+
+/*
+ * hist_index - The bucket that counts value v
+ */
+static int hist_index(uint64_t v)
+{
+    int e;
+
+    if (v < HIST_SUB)
+	return (int)v;
+    e = 63 - __builtin_clzll(v);
+    return ((e - HIST_SUB_BITS + 1) << HIST_SUB_BITS) | 
+	(int)((v >> (e - HIST_SUB_BITS)) & (HIST_SUB - 1));
+}
+
+/*
+ * hist_lowest - The lowest value counted in bucket i
+ */
+static uint64_t hist_lowest(int i)
+{
+    int e = (i >> HIST_SUB_BITS) + HIST_SUB_BITS - 1;
+
+    if (i < HIST_SUB)
+	return i;
+    return (uint64_t)(HIST_SUB + (i & (HIST_SUB - 1))) << (e - HIST_SUB_BITS);
+}
+
+/*
+ * hist_add - Count one value
+ */
+static void hist_add(hist_t *h, uint64_t v)
+{
+    h->buckets[hist_index(v)]++;
+    h->count++;
+    h->sum += v;
+    if (v > h->max)
+	h->max = v;
+}
+
+/*
+ * hist_merge - Add the counts of src to those of dst
+ */
+static void hist_merge(hist_t *dst, hist_t *src)
+{
+    int i;
+
+    for (i = 0; i < HIST_BUCKETS; i++)
+	dst->buckets[i] += src->buckets[i];
+    dst->count += src->count;
+    dst->sum += src->sum;
+    if (src->max > dst->max)
+	dst->max = src->max;
+}
+
+/*
+ * hist_percentile - The value at or below which a fraction q of the
+ *     counted values lie, reported as the highest value of its bucket
+ */
+static uint64_t hist_percentile(hist_t *h, double q)
+{
+    uint64_t target = (uint64_t)(q * h->count + 0.999999);
+    uint64_t seen = 0;
+    int i;
+
+    if (target == 0)
+	target = 1;
+    for (i = 0; i < HIST_BUCKETS - 1; i++) {
+	seen += h->buckets[i];
+	if (seen >= target)
+	    break;
+    }
+    if (i == HIST_BUCKETS - 1 || hist_lowest(i + 1) - 1 > h->max)
+	return h->max;
+    return hist_lowest(i + 1) - 1;
+}
+
+/*
+ * size_class - The size class of a request of size bytes: <=16, <=64,
+ *     ... <=64K, then everything larger
+ */
+static int size_class(size_t size)
+{
+    size_t limit = 16;
+    int c = 0;
+
+    while (size > limit && c < NUM_SIZE_CLASSES - 1) {
+	limit <<= 2;
+	c++;
+    }
+    return c;
+}
+
+/*
+ * record_latency - Count the latency of one call
+ */
+static void record_latency(latency_t *lat, int op, size_t size, uint64_t ns)
+{
+    hist_add(&lat->hists[op][size_class(size)], ns);
+}
+
+/**********************************************************************
+ * The following routines replay binary logs captured by mmtrace.so.
+ * Each replay streams the log through a buffer of LOGBUF records, so a
+ * log of any length replays in constant memory apart from the blocks
+ * live at each point, which are kept in a hash table keyed by the
+ * address the traced program saw.  Every buffer of records is turned
+ * into requests on block ids, as in a trace, before any of them runs,
+ * and only running the requests is timed.
+ **********************************************************************/
+
+/*
+ * open_log - Open a binary log and check its header
+ */
+static void open_log(logreader_t *log, char *filename)
+{
+    mmlog_hdr_t hdr;
+
+    if (verbose > 1)
+	printf("Reading log: %s\n", filename);
+
+    log->name = filename;
+    if ((log->file = fopen(filename, "rb")) == NULL) {
+	sprintf(msg, "Could not open %s in open_log", filename);
+	unix_error(msg);
+    }
+    if (fread(&hdr, sizeof(hdr), 1, log->file) != 1 ||
+	memcmp(hdr.magic, MMLOG_MAGIC, sizeof(hdr.magic)) != 0 ||
+	hdr.version != MMLOG_VERSION || hdr.recsize != sizeof(mmlog_rec_t)) {
+	sprintf(msg, "%s is not a version %d log", filename, MMLOG_VERSION);
+	app_error(msg);
+    }
+    log->n = log->next = 0;
+    log->recnum = -1;
+}
+
+/*
+ * rewind_log - Start reading the records of a log over again
+ */
+static void rewind_log(logreader_t *log)
+{
+    if (fseek(log->file, sizeof(mmlog_hdr_t), SEEK_SET) < 0)
+	unix_error("fseek failed in rewind_log");
+    log->n = log->next = 0;
+    log->recnum = -1;
+}
+
+/*
+ * next_record - Return the next record of a log, or NULL at its end
+ */
+static mmlog_rec_t *next_record(logreader_t *log)
+{
+    if (log->next == log->n) {
+	log->n = fread(log->buf, sizeof(mmlog_rec_t), LOGBUF, log->file);
+	log->next = 0;
+	if (log->n == 0)
+	    return NULL;
+    }
+    log->recnum++;
+    return &log->buf[log->next++];
+}
+
+/*
+ * find_block - Return the slot of the live block the traced program
+ *     knew as key, or NULL if there is none
+ */
+static logslot_t *find_block(blockmap_t *map, uint64_t key)
+{
+    size_t i;
+
+    if (map->slots == NULL)
+	return NULL;
+    for (i = BLOCKHASH(key, map->mask); map->slots[i].key != 0; 
+	 i = (i + 1) & map->mask)
+	if (map->slots[i].key == key)
+	    return &map->slots[i];
+    return NULL;
+}
+
+/*
+ * add_block - Add a slot for key, which must not be live, to the table
+ *     and return it, doubling the table when it gets half full
+ */
+static logslot_t *add_block(blockmap_t *map, uint64_t key)
+{
+    logslot_t *old = map->slots;
+    size_t oldsize = old ? map->mask + 1 : 0;
+    size_t i, j;
+
+    if (2 * (map->count + 1) > oldsize) {
+	size_t size = old ? 2 * oldsize : 1024;
+	if ((map->slots = (logslot_t *)calloc(size, sizeof(logslot_t))) == NULL)
+	    unix_error("calloc failed in add_block");
+	map->mask = size - 1;
+	for (j = 0; j < oldsize; j++) {
+	    if (old[j].key == 0)
+		continue;
+	    for (i = BLOCKHASH(old[j].key, map->mask); map->slots[i].key != 0; 
+		 i = (i + 1) & map->mask)
+		;
+	    map->slots[i] = old[j];
+	}
+	free(old);
+    }
+
+    for (i = BLOCKHASH(key, map->mask); map->slots[i].key != 0; 
+	 i = (i + 1) & map->mask)
+	;
+    map->slots[i].key = key;
+    map->count++;
+    return &map->slots[i];
+}
+
+/*
+ * remove_block - Remove slot s from the table.  Slots further along
+ *     its probe sequence move back into the hole, so s and any other
+ *     pointers into the table are stale afterwards.
+ */
+static void remove_block(blockmap_t *map, logslot_t *s)
+{
+    size_t i = s - map->slots;
+    size_t j = i;
+    size_t h;
+
+    for (;;) {
+	j = (j + 1) & map->mask;
+	if (map->slots[j].key == 0)
+	    break;
+	/* Move slot j into the hole unless its home lies cyclically in (i, j] */
+	h = BLOCKHASH(map->slots[j].key, map->mask);
+	if ((i < j) ? (h <= i || h > j) : (h <= i && h > j)) {
+	    map->slots[i] = map->slots[j];
+	    i = j;
+	}
+    }
+    map->slots[i].key = 0;
+    map->count--;
+}
+
+/*
+ * clear_blocks - Empty the table, keeping its slots for the next replay
+ */
+static void clear_blocks(blockmap_t *map)
+{
+    if (map->slots != NULL)
+	memset(map->slots, 0, (map->mask + 1) * sizeof(logslot_t));
+    map->count = 0;
+}
+
+/*
+ * grow_array - Make room for element used of *array, which holds *max
+ *     elements of size elsize, doubling it when it is full
+ */
+static void grow_array(void *array, long used, long *max, size_t elsize)
+{
+    void **p = (void **)array;
+
+    if (used < *max)
+	return;
+    *max = *max ? 2 * *max : 1024;
+    if ((*p = realloc(*p, *max * elsize)) == NULL)
+	unix_error("realloc failed in grow_array");
+}
+
+/*
+ * add_op - Append a request for block id to the requests read last
+ */
+static void add_op(replay_t *rp, int type, int id, size_t size, 
+		   size_t align, long recnum)
+{
+    logop_t *op = &rp->ops[rp->num_ops++];
+
+    op->type = type;
+    op->id = id;
+    op->size = size;
+    for (op->align = 0; ((size_t)1 << op->align) < align; op->align++)
+	;
+    op->recnum = recnum;
+}
+
+/*
+ * new_id - Return an id for a block allocated by the log, using the id
+ *     of a freed block again if there is one, so there are only as many
+ *     ids as blocks were ever live at once
+ */
+static int new_id(replay_t *rp)
+{
+    int id;
+
+    if (rp->num_free > 0)
+	return rp->free_ids[--rp->num_free];
+    id = rp->num_ids++;
+    if (id < 0)
+	app_error("Too many live blocks in the log");
+    grow_array(&rp->blocks, id, &rp->max_ids, sizeof(logblock_t));
+    rp->blocks[id].p = NULL;
+    return id;
+}
+
+/*
+ * read_ops - Read up to LOGBUF more records of the log into rp->ops,
+ *     and return the number of requests they make, 0 at the end of the
+ *     log.  Frees of blocks allocated before logging started are
+ *     dropped, a realloc of one becomes a malloc, and a block handed
+ *     out at the address of a live one frees that first.
+ */
+static long read_ops(replay_t *rp)
+{
+    mmlog_rec_t *r;
+    logslot_t *s;
+    long n;
+    int type, id;
+
+    rp->num_ops = 0;
+    for (n = 0; n < LOGBUF && (r = next_record(&rp->log)) != NULL; n++) {
+	type = r->type;
+	switch (type) {
+	case MMLOG_REALLOC:
+	    if ((s = find_block(&rp->map, r->old)) != NULL) {
+		id = s->id;
+		remove_block(&rp->map, s);
+		break;
+	    }
+	    /* A realloc of a block allocated before logging started */
+	    type = MMLOG_MALLOC;
+	    /* fall through */
+	case MMLOG_MALLOC:
+	case MMLOG_CALLOC:
+	case MMLOG_MEMALIGN:
+	    /* mm_malloc(0) returns NULL, and so does the replay of a free of it */
+	    if (r->size == 0)
+		continue;
+	    id = new_id(rp);
+	    break;
+	case MMLOG_FREE:
+	    break;
+	default:
+	    sprintf(msg, "Bogus record type (%u) in log %s", r->type, 
+		    rp->log.name);
+	    app_error(msg);
+	}
+
+	/* Free the block at r->ptr: it is the block freed, or one freed
+	   somewhere the interposer could not see */
+	if ((s = find_block(&rp->map, r->ptr)) != NULL) {
+	    add_op(rp, MMLOG_FREE, s->id, 0, 0, rp->log.recnum);
+	    grow_array(&rp->free_ids, rp->num_free, &rp->max_free, sizeof(int));
+	    rp->free_ids[rp->num_free++] = s->id;
+	    remove_block(&rp->map, s);
+	}
+	if (type != MMLOG_FREE) {
+	    add_block(&rp->map, r->ptr)->id = id;
+	    add_op(rp, type, id, r->size, 
+		   type == MMLOG_MEMALIGN ? r->old : 0, rp->log.recnum);
+	}
+    }
+    return rp->num_ops;
+}
+
+/*
+ * replay_free - Free block id of a log
+ */
+static void replay_free(replay_t *rp, int id, int check)
+{
+    logblock_t *b = &rp->blocks[id];
+    uint64_t t;
+
+    if (check)
+	remove_range(&rp->ranges, b->p);
+    t = rp->lat ? now_ns() : 0;
+    mm_free(b->p);
+    if (rp->lat)
+	record_latency(rp->lat, LAT_FREE, b->size, now_ns() - t);
+    rp->live -= b->size;
+    b->p = NULL;
+}
+
+/*
+ * replay_alloc - Replay a request that allocates a new block
+ */
+static int replay_alloc(replay_t *rp, logop_t *op, int check)
+{
+    logblock_t *b = &rp->blocks[op->id];
+    size_t align = (size_t)1 << op->align;
+    char *p;
+    uint64_t t;
+
+    t = rp->lat ? now_ns() : 0;
+    if (op->type == MMLOG_MEMALIGN)
+	p = mm_memalign(align, op->size);
+    else
+	p = mm_malloc(op->size);
+    if (rp->lat)
+	record_latency(rp->lat, LAT_MALLOC, op->size, now_ns() - t);
+    if (p == NULL) {
+	malloc_error(LOGTRACE, op->recnum, "mm_malloc failed.");
+	return 0;
+    }
+    if (op->type == MMLOG_CALLOC)
+	memset(p, 0, op->size);
+
+    if (check) {
+	if ((uintptr_t)p % align != 0) {
+	    sprintf(msg, "Payload address (%p) not aligned to %lu bytes", 
+		    p, (unsigned long)align);
+	    malloc_error(LOGTRACE, op->recnum, msg);
+	    return 0;
+	}
+	if (add_range(&rp->ranges, p, op->size, LOGTRACE, op->recnum) == 0)
+	    return 0;
+	memset(p, op->recnum & 0xFF, op->size);
+    }
+
+    b->p = p;
+    b->size = op->size;
+    b->fill = op->recnum & 0xFF;
+    rp->live += op->size;
+    return 1;
+}
+
+/*
+ * replay_realloc - Replay a realloc of a block
+ */
+static int replay_realloc(replay_t *rp, logop_t *op, int check)
+{
+    logblock_t *b = &rp->blocks[op->id];
+    char *newp;
+    size_t oldsize, i;
+    uint64_t t;
+
+    t = rp->lat ? now_ns() : 0;
+    newp = mm_realloc(b->p, op->size);
+    if (rp->lat)
+	record_latency(rp->lat, LAT_REALLOC, op->size, now_ns() - t);
+    if (newp == NULL) {
+	malloc_error(LOGTRACE, op->recnum, "mm_realloc failed.");
+	return 0;
+    }
+
+    if (check) {
+	remove_range(&rp->ranges, b->p);
+	if (add_range(&rp->ranges, newp, op->size, LOGTRACE, op->recnum) == 0)
+	    return 0;
+	oldsize = (op->size < b->size) ? op->size : b->size;
+	for (i = 0; i < oldsize; i++) {
+	    if ((unsigned char)newp[i] != b->fill) {
+		malloc_error(LOGTRACE, op->recnum, "mm_realloc did not preserve the "
+			     "data from old block");
+		return 0;
+	    }
+	}
+	memset(newp, op->recnum & 0xFF, op->size);
+    }
+
+    rp->live += op->size - b->size;
+    b->p = newp;
+    b->size = op->size;
+    b->fill = op->recnum & 0xFF;
+    return 1;
+}
+
+/*
+ * replay_log - Replay the whole log against the mm package from a
+ *     fresh heap.  With check set, every payload is checked and filled
+ *     as in eval_mm_valid, and the replay stops at the first error.
+ *     Returns 1 if the replay got to the end of the log.
+ */
+static int replay_log(replay_t *rp, int check)
+{
+    logop_t *op;
+    long i;
+    uint64_t t;
+
+    /* Reset the heap, the live blocks, the range tree and the log */
+    mem_reset_brk();
+    clear_blocks(&rp->map);
+    clear_ranges(&rp->ranges);
+    rewind_log(&rp->log);
+    rp->num_free = rp->num_ids = 0;
+    rp->total_ops = 0;
+    rp->ns = 0;
+    rp->live = rp->peak = 0;
+
+    if (mm_init() < 0) {
+	malloc_error(LOGTRACE, 0, "mm_init failed.");
+	return 0;
+    }
+
+    while (read_ops(rp) > 0) {
+	t = now_ns();
+	for (i = 0; i < rp->num_ops; i++) {
+	    op = &rp->ops[i];
+	    switch (op->type) {
+	    case MMLOG_MALLOC:
+	    case MMLOG_CALLOC:
+	    case MMLOG_MEMALIGN:
+		if (!replay_alloc(rp, op, check))
+		    return 0;
+		break;
+
+	    case MMLOG_REALLOC:
+		if (!replay_realloc(rp, op, check))
+		    return 0;
+		break;
+
+	    default: /* MMLOG_FREE */
+		replay_free(rp, op->id, check);
+		break;
+	    }
+	    if (rp->live > rp->peak)
+		rp->peak = rp->live;
+	}
+	rp->ns += now_ns() - t;
+	rp->total_ops += rp->num_ops;
+    }
+    return 1;
+}
+
+/*
+ * free_live - Free the blocks still live at the end of a replay.  Logs
+ *     of real programs seldom free everything, and a large block left
+ *     mapped would count toward the peak of the next replay.
+ */
+static void free_live(replay_t *rp)
+{
+    long id;
+
+    for (id = 0; id < rp->num_ids; id++)
+	if (rp->blocks[id].p != NULL)
+	    replay_free(rp, id, 0);
+}
+
+/*
+ * eval_log - Check the mm package for correctness on a binary log,
+ *     then measure its utilization and throughput, and the latency of
+ *     each call if lat is not NULL.  A log is replayed just once for
+ *     its throughput, since it can take minutes to get through.
+ */
+static void eval_log(char *filename, stats_t *stats, latency_t *lat)
+{
+    replay_t *rp;
+
+    if ((rp = (replay_t *)calloc(1, sizeof(replay_t))) == NULL)
+	unix_error("calloc failed in eval_log");
+    open_log(&rp->log, filename);
+
+    if (verbose > 1)
+	printf("Checking mm_malloc for correctness, ");
+    stats->valid = replay_log(rp, 1);
+    stats->ops = rp->total_ops;
+    if (stats->valid) {
+	free_live(rp);
+	if (verbose > 1)
+	    printf("efficiency, ");
+	replay_log(rp, 0);
+	stats->util = (double)rp->peak / (double)mem_peaksize();
+	free_live(rp);
+	if (verbose > 1)
+	    printf("and performance.\n");
+	replay_log(rp, 0);
+	stats->secs = rp->ns / 1e9;
+	free_live(rp);
+	if (lat != NULL) {
+	    rp->lat = lat;
+	    replay_log(rp, 0);
+	    rp->lat = NULL;
+	    free_live(rp);
+	}
+    }
+
+    clear_ranges(&rp->ranges);
+    fclose(rp->log.file);
+    free(rp->map.slots);
+    free(rp->free_ids);
+    free(rp->blocks);
+    free(rp);
+}
+
+/**********************************************************************
+ * The following functions evaluate the correctness, space utilization,
+ * and throughput of the libc and mm malloc packages.
+ **********************************************************************/
+
+/*
+ * eval_mm_valid - Check the mm malloc package for correctness
+ */
+static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges) 
+{
+    int i, j;
+    int index;
+    int size;
+    int oldsize;
+    char *newp;
+    char *oldp;
+    char *p;
+    
+    /* Reset the heap and free any records in the range tree */
+    mem_reset_brk();
+    clear_ranges(ranges);
+
+    /* Call the mm package's init function */
+    if (mm_init() < 0) {
+	malloc_error(tracenum, 0, "mm_init failed.");
+	return 0;
+    }
+
+    /* Interpret each operation in the trace in order */
+    for (i = 0;  i < trace->num_ops;  i++) {
+	index = trace->ops[i].index;
+	size = trace->ops[i].size;
+
+        switch (trace->ops[i].type) {
+
+        case ALLOC: /* mm_malloc */
+
+	    /* Call the student's malloc */
+	    if ((p = mm_malloc(size)) == NULL) {
+		malloc_error(tracenum, i, "mm_malloc failed.");
+		return 0;
+	    }
+	    
+	    /* 
+	     * Test the range of the new block for correctness and add it 
+	     * to the range tree if OK. The block must be  be aligned properly,
+	     * and must not overlap any currently allocated block. 
+	     */ 
+	    if (add_range(ranges, p, size, tracenum, i) == 0)
+		return 0;
+	    
+	    /* ADDED: cgw
+	     * fill range with low byte of index.  This will be used later
+	     * if we realloc the block and wish to make sure that the old
+	     * data was copied to the new block
+	     */
+	    memset(p, index & 0xFF, size);
+
+	    /* Remember region */
+	    trace->blocks[index] = p;
+	    trace->block_sizes[index] = size;
+	    break;
+
+        case REALLOC: /* mm_realloc */
+	    
+	    /* Call the student's realloc */
+	    oldp = trace->blocks[index];
+	    if ((newp = mm_realloc(oldp, size)) == NULL) {
+		malloc_error(tracenum, i, "mm_realloc failed.");
+		return 0;
+	    }
+	    
+	    /* Remove the old region from the range tree */
+	    remove_range(ranges, oldp);
+	    
+	    /* Check new block for correctness and add it to range tree */
+	    if (add_range(ranges, newp, size, tracenum, i) == 0)
+		return 0;
+	    
+	    /* ADDED: cgw
+	     * Make sure that the new block contains the data from the old 
+	     * block and then fill in the new block with the low order byte
+	     * of the new index
+	     */
+	    oldsize = trace->block_sizes[index];
+	    if (size < oldsize) oldsize = size;
+	    for (j = 0; j < oldsize; j++) {
+	      if ((unsigned char)newp[j] != (index & 0xFF)) {
+		malloc_error(tracenum, i, "mm_realloc did not preserve the "
+			     "data from old block");
+		return 0;
+	      }
+	    }
+	    memset(newp, index & 0xFF, size);
+
+	    /* Remember region */
+	    trace->blocks[index] = newp;
+	    trace->block_sizes[index] = size;
+	    break;
+
+        case FREE: /* mm_free */
+	    
+	    /* Remove region from tree and call student's free function */
+	    p = trace->blocks[index];
+	    remove_range(ranges, p);
+	    mm_free(p);
+	    break;
+
+	default:
+	    app_error("Nonexistent request type in eval_mm_valid");
+        }
+
+    }
+
+    /* As far as we know, this is a valid malloc package */
+    return 1;
+}
+
+/* 
+ * eval_mm_util - Evaluate the space utilization of the student's package
+ *   The idea is to remember the high water mark "hwm" of the heap for 
+ *   an optimal allocator, i.e., no gaps and no internal fragmentation.
+ *   Utilization is the ratio hwm/peaksize, where peaksize is the 
+ *   most memory the heap and any regions from mem_map() held at once
+ *   while running the student's malloc package on the trace. Memory
+ *   that was mapped and unmapped again only counts while it was
+ *   mapped.
+ *   
+ */
+static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges)
+{   
+    int i;
+    int index;
+    int size, newsize, oldsize;
+    int max_total_size = 0;
+    int total_size = 0;
+    char *p;
+    char *newp, *oldp;
+
+    /* initialize the heap and the mm malloc package */
+    mem_reset_brk();
+    if (mm_init() < 0)
+	app_error("mm_init failed in eval_mm_util");
+
+    for (i = 0;  i < trace->num_ops;  i++) {
+        switch (trace->ops[i].type) {
+
+        case ALLOC: /* mm_alloc */
+	    index = trace->ops[i].index;
+	    size = trace->ops[i].size;
+
+	    if ((p = mm_malloc(size)) == NULL) 
+		app_error("mm_malloc failed in eval_mm_util");
+	    
+	    /* Remember region and size */
+	    trace->blocks[index] = p;
+	    trace->block_sizes[index] = size;
+	    
+	    /* Keep track of current total size
+	     * of all allocated blocks */
+	    total_size += size;
+	    
+	    /* Update statistics */
+	    max_total_size = (total_size > max_total_size) ?
+		total_size : max_total_size;
+	    break;
+
+	case REALLOC: /* mm_realloc */
+	    index = trace->ops[i].index;
+	    newsize = trace->ops[i].size;
+	    oldsize = trace->block_sizes[index];
+
+	    oldp = trace->blocks[index];
+	    if ((newp = mm_realloc(oldp,newsize)) == NULL)
+		app_error("mm_realloc failed in eval_mm_util");
+
+	    /* Remember region and size */
+	    trace->blocks[index] = newp;
+	    trace->block_sizes[index] = newsize;
+	    
+	    /* Keep track of current total size
+	     * of all allocated blocks */
+	    total_size += (newsize - oldsize);
+	    
+	    /* Update statistics */
+	    max_total_size = (total_size > max_total_size) ?
+		total_size : max_total_size;
+	    break;
+
+        case FREE: /* mm_free */
+	    index = trace->ops[i].index;
+	    size = trace->block_sizes[index];
+	    p = trace->blocks[index];
+	    
+	    mm_free(p);
+	    
+	    /* Keep track of current total size
+	     * of all allocated blocks */
+	    total_size -= size;
+	    
+	    break;
+
+	default:
+	    app_error("Nonexistent request type in eval_mm_util");
+
+        }
+    }
+
+    return ((double)max_total_size / (double)mem_peaksize());
+}
+
+
+/*
+ * eval_mm_speed - This is the function that is used by fcyc()
+ *    to measure the running time of the mm malloc package.
+ */
+static void eval_mm_speed(void *ptr)
+{
+    int i, index, size, newsize;
+    char *p, *newp, *oldp, *block;
+    trace_t *trace = ((speed_t *)ptr)->trace;
+
+    /* Reset the heap and initialize the mm package */
+    mem_reset_brk();
+    if (mm_init() < 0) 
+	app_error("mm_init failed in eval_mm_speed");
+
+    /* Interpret each trace request */
+    for (i = 0;  i < trace->num_ops;  i++)
+        switch (trace->ops[i].type) {
+
+        case ALLOC: /* mm_malloc */
+            index = trace->ops[i].index;
+            size = trace->ops[i].size;
+            if ((p = mm_malloc(size)) == NULL)
+		app_error("mm_malloc error in eval_mm_speed");
+            trace->blocks[index] = p;
+            break;
+
+	case REALLOC: /* mm_realloc */
+	    index = trace->ops[i].index;
+            newsize = trace->ops[i].size;
+	    oldp = trace->blocks[index];
+            if ((newp = mm_realloc(oldp,newsize)) == NULL)
+		app_error("mm_realloc error in eval_mm_speed");
+            trace->blocks[index] = newp;
+            break;
+
+        case FREE: /* mm_free */
+            index = trace->ops[i].index;
+            block = trace->blocks[index];
+            mm_free(block);
+            break;
+
+	default:
+	    app_error("Nonexistent request type in eval_mm_valid");
+        }
+}
+
+/*
+ * eval_mm_latency - Run the trace once more, timing every call into
+ *     the mm package on its own
+ */
+static void eval_mm_latency(trace_t *trace, latency_t *lat)
+{
+    int i, index, size;
+    char *p;
+    uint64_t t;
+
+    /* Reset the heap and initialize the mm package */
+    mem_reset_brk();
+    if (mm_init() < 0) 
+	app_error("mm_init failed in eval_mm_latency");
+
+    for (i = 0;  i < trace->num_ops;  i++) {
+	index = trace->ops[i].index;
+	size = trace->ops[i].size;
+        switch (trace->ops[i].type) {
+
+        case ALLOC: /* mm_malloc */
+	    t = now_ns();
+	    p = mm_malloc(size);
+	    record_latency(lat, LAT_MALLOC, size, now_ns() - t);
+            if (p == NULL)
+		app_error("mm_malloc error in eval_mm_latency");
+            trace->blocks[index] = p;
+	    trace->block_sizes[index] = size;
+            break;
+
+	case REALLOC: /* mm_realloc */
+	    t = now_ns();
+	    p = mm_realloc(trace->blocks[index], size);
+	    record_latency(lat, LAT_REALLOC, size, now_ns() - t);
+            if (p == NULL)
+		app_error("mm_realloc error in eval_mm_latency");
+            trace->blocks[index] = p;
+	    trace->block_sizes[index] = size;
+            break;
+
+        case FREE: /* mm_free */
+	    t = now_ns();
+            mm_free(trace->blocks[index]);
+	    record_latency(lat, LAT_FREE, trace->block_sizes[index], now_ns() - t);
+            break;
+
+	default:
+	    app_error("Nonexistent request type in eval_mm_latency");
+        }
+    }
+}
+
+/*
+ * eval_libc_valid - We run this function to make sure that the
+ *    libc malloc can run to completion on the set of traces.
+ *    We'll be conservative and terminate if any libc malloc call fails.
+ *
+ */
+static int eval_libc_valid(trace_t *trace, int tracenum)
+{
+    int i, newsize;
+    char *p, *newp, *oldp;
+
+    for (i = 0;  i < trace->num_ops;  i++) {
+        switch (trace->ops[i].type) {
+
+        case ALLOC: /* malloc */
+	    if ((p = malloc(trace->ops[i].size)) == NULL) {
+		malloc_error(tracenum, i, "libc malloc failed");
+		unix_error("System message");
+	    }
+	    trace->blocks[trace->ops[i].index] = p;
+	    break;
+
+	case REALLOC: /* realloc */
+            newsize = trace->ops[i].size;
+	    oldp = trace->blocks[trace->ops[i].index];
+	    if ((newp = realloc(oldp, newsize)) == NULL) {
+		malloc_error(tracenum, i, "libc realloc failed");
+		unix_error("System message");
+	    }
+	    trace->blocks[trace->ops[i].index] = newp;
+	    break;
+	    
+        case FREE: /* free */
+	    free(trace->blocks[trace->ops[i].index]);
+	    break;
+
+	default:
+	    app_error("invalid operation type  in eval_libc_valid");
+	}
+    }
+
+    return 1;
+}
+
+/* 
+ * eval_libc_speed - This is the function that is used by fcyc() to
+ *    measure the running time of the libc malloc package on the set
+ *    of traces.
+ */
+static void eval_libc_speed(void *ptr)
+{
+    int i;
+    int index, size, newsize;
+    char *p, *newp, *oldp, *block;
+    trace_t *trace = ((speed_t *)ptr)->trace;
+
+    for (i = 0;  i < trace->num_ops;  i++) {
+        switch (trace->ops[i].type) {
+        case ALLOC: /* malloc */
+	    index = trace->ops[i].index;
+	    size = trace->ops[i].size;
+	    if ((p = malloc(size)) == NULL)
+		unix_error("malloc failed in eval_libc_speed");
+	    trace->blocks[index] = p;
+	    break;
+
+	case REALLOC: /* realloc */
+	    index = trace->ops[i].index;
+	    newsize = trace->ops[i].size;
+	    oldp = trace->blocks[index];
+	    if ((newp = realloc(oldp, newsize)) == NULL)
+		unix_error("realloc failed in eval_libc_speed\n");
+	    
+	    trace->blocks[index] = newp;
+	    break;
+	    
+        case FREE: /* free */
+	    index = trace->ops[i].index;
+	    block = trace->blocks[index];
+	    free(block);
+	    break;
+	}
+    }
+}
+
+/*************************************
+ * Some miscellaneous helper routines
+ ************************************/
+
+
+/*
+ * printresults - prints a performance summary for some malloc package
+ */
+static void printresults(int n, stats_t *stats) 
+{
+    int i;
+    double secs = 0;
+    double ops = 0;
+    double util = 0;
+
+    /* Print the individual results for each trace */
+    printf("%5s%7s %5s%8s%10s%6s\n", 
+	   "trace", " valid", "util", "ops", "secs", "Kops");
+    for (i=0; i < n; i++) {
+	if (stats[i].valid) {
+	    printf("%2d%10s%5.0f%%%8.0f%10.6f%6.0f\n", 
+		   i,
+		   "yes",
+		   stats[i].util*100.0,
+		   stats[i].ops,
+		   stats[i].secs,
+		   (stats[i].ops/1e3)/stats[i].secs);
+	    secs += stats[i].secs;
+	    ops += stats[i].ops;
+	    util += stats[i].util;
+	}
+	else {
+	    printf("%2d%10s%6s%8s%10s%6s\n", 
+		   i,
+		   "no",
+		   "-",
+		   "-",
+		   "-",
+		   "-");
+	}
+    }
+
+    /* Print the aggregate results for the set of traces */
+    if (errors == 0) {
+	printf("%12s%5.0f%%%8.0f%10.6f%6.0f\n", 
+	       "Total       ",
+	       (util/n)*100.0,
+	       ops, 
+	       secs,
+	       (ops/1e3)/secs);
+    }
+    else {
+	printf("%12s%6s%8s%10s%6s\n", 
+	       "Total       ",
+	       "-", 
+	       "-", 
+	       "-", 
+	       "-");
+    }
+
+}
+
+/* Names of the ops and size classes in latency reports */
+static char *lat_op_names[NUM_LAT_OPS] = {"malloc", "free", "realloc"};
+static char *size_class_names[NUM_SIZE_CLASSES] = {
+    "<=16", "<=64", "<=256", "<=1K", "<=4K", "<=16K", "<=64K", ">64K"
+};
+
+/*
+ * printhist - prints one row of a latency report
+ */
+static void printhist(char *label, char *op, hist_t *h)
+{
+    printf("%-12s%8s%10.0f%8.0f%8lu%8lu%8lu%10lu\n",
+	   label, op,
+	   (double)h->count,
+	   h->sum / h->count,
+	   (unsigned long)hist_percentile(h, 0.50),
+	   (unsigned long)hist_percentile(h, 0.99),
+	   (unsigned long)hist_percentile(h, 0.999),
+	   (unsigned long)h->max);
+}
+
+/*
+ * printlatency - prints the latency of each op, per trace and then
+ *     per size class over all the traces
+ */
+static void printlatency(int n, latency_t *lat)
+{
+    hist_t *h = (hist_t *)malloc(sizeof(hist_t));
+    char label[MAXLINE];
+    int i, op, c;
+
+    if (h == NULL)
+	unix_error("malloc failed in printlatency");
+
+    printf("\nLatency in ns (includes %lu ns of timer overhead):\n",
+	   (unsigned long)timer_overhead());
+    printf("%-12s%8s%10s%8s%8s%8s%8s%10s\n",
+	   "trace", "op", "ops", "mean", "p50", "p99", "p99.9", "max");
+    for (i = 0; i < n; i++) {
+	for (op = 0; op < NUM_LAT_OPS; op++) {
+	    memset(h, 0, sizeof(hist_t));
+	    for (c = 0; c < NUM_SIZE_CLASSES; c++)
+		hist_merge(h, &lat[i].hists[op][c]);
+	    if (h->count == 0)
+		continue;
+	    sprintf(label, "%2d", i);
+	    printhist(label, lat_op_names[op], h);
+	}
+    }
+
+    printf("%-12s%8s%10s%8s%8s%8s%8s%10s\n",
+	   "size", "op", "ops", "mean", "p50", "p99", "p99.9", "max");
+    for (c = 0; c < NUM_SIZE_CLASSES; c++) {
+	for (op = 0; op < NUM_LAT_OPS; op++) {
+	    memset(h, 0, sizeof(hist_t));
+	    for (i = 0; i < n; i++)
+		hist_merge(h, &lat[i].hists[op][c]);
+	    if (h->count == 0)
+		continue;
+	    printhist(size_class_names[c], lat_op_names[op], h);
+	}
+    }
+    free(h);
+}
+
+/*
+ * writelatency - writes the latency of each op in each size class of
+ *     each trace to filename as CSV
+ */
+static void writelatency(char *filename, int n, latency_t *lat)
+{
+    FILE *f;
+    hist_t *h;
+    int i, op, c;
+
+    if ((f = fopen(filename, "w")) == NULL) {
+	sprintf(msg, "Could not open %s in writelatency", filename);
+	unix_error(msg);
+    }
+    fprintf(f, "trace,op,size,ops,mean_ns,p50_ns,p99_ns,p999_ns,max_ns\n");
+    for (i = 0; i < n; i++) {
+	for (op = 0; op < NUM_LAT_OPS; op++) {
+	    for (c = 0; c < NUM_SIZE_CLASSES; c++) {
+		h = &lat[i].hists[op][c];
+		if (h->count == 0)
+		    continue;
+		fprintf(f, "%d,%s,%s,%lu,%.1f,%lu,%lu,%lu,%lu\n",
+			i, lat_op_names[op], size_class_names[c],
+			(unsigned long)h->count,
+			h->sum / h->count,
+			(unsigned long)hist_percentile(h, 0.50),
+			(unsigned long)hist_percentile(h, 0.99),
+			(unsigned long)hist_percentile(h, 0.999),
+			(unsigned long)h->max);
+	    }
+	}
+    }
+    fclose(f);
+}
+
+/* 
+ * app_error - Report an arbitrary application error
+ */
+void app_error(char *msg) 
+{
+    printf("%s\n", msg);
+    exit(1);
+}
+
+/* 
+ * unix_error - Report a Unix-style error
+ */
+void unix_error(char *msg) 
+{
+    printf("%s: %s\n", msg, strerror(errno));
+    exit(1);
+}
+
+/*
+ * malloc_error - Report an error returned by the mm_malloc package
+ */
+void malloc_error(int tracenum, long opnum, char *msg)
+{
+    errors++;
+    if (tracenum == LOGTRACE)
+	printf("ERROR [log, record %ld]: %s\n", opnum, msg);
+    else
+	printf("ERROR [trace %d, line %ld]: %s\n", tracenum, LINENUM(opnum), msg);
+}
+
+/* 
+ * usage - Explain the command line arguments
+ */
+static void usage(void) 
+{
+    fprintf(stderr, "Usage: mdriver [-hvValL] [-c <csv>] [-f <file>] [-r <log>] [-t <dir>]\n");
+    fprintf(stderr, "Options\n");
+    fprintf(stderr, "\t-a         Don't check the team structure.\n");
+    fprintf(stderr, "\t-c <csv>   Like -L, and write the latencies to <csv>.\n");
+    fprintf(stderr, "\t-f <file>  Use <file> as the trace file.\n");
+    fprintf(stderr, "\t-g         Generate summary info for autograder.\n");
+    fprintf(stderr, "\t-h         Print this message.\n");
+    fprintf(stderr, "\t-l         Run libc malloc as well.\n");
+    fprintf(stderr, "\t-L         Report latency percentiles of each call.\n");
+    fprintf(stderr, "\t-r <log>   Replay a binary log captured with mmtrace.so.\n");
+    fprintf(stderr, "\t-t <dir>   Directory to find default traces.\n");
+    fprintf(stderr, "\t-v         Print per-trace performance breakdowns.\n");
+    fprintf(stderr, "\t-V         Print additional debug info.\n");
+}
@@ -0,0 +1,290 @@
+/*
+ * memlib.c - a module that simulates the memory system.  Needed because it 
+ *            allows us to interleave calls from the student's malloc package 
+ *            with the system's malloc package in libc.
+ */
+#define _GNU_SOURCE          /* for mremap */
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <string.h>
+#include <errno.h>
+
+#include "memlib.h"
+#include "config.h"
+
+/* private variables */
+static char *mem_start_brk;  /* points to first byte of heap */
+static char *mem_brk;        /* points to last byte of heap */
+static char *mem_max_addr;   /* largest legal heap address */ 
+
+/* regions handed out by mem_map, so the driver can check payloads in them */
+typedef struct map_region {
+    char *start;
+    size_t size;
+    struct map_region *next;
+} map_region_t;
+
+static map_region_t *mem_maps;  /* live mem_map regions */
+static size_t mem_mapped;       /* bytes in them */
+static size_t mem_peak;         /* high water mark of heap plus mapped bytes */
+static char mem_maps_lock;      /* guards the above and mem_brk; mem_map may be called by several threads */
+
+static void maps_lock(void)
+{
+    while (__atomic_test_and_set(&mem_maps_lock, __ATOMIC_ACQUIRE))
+	;
+}
+
+static void maps_unlock(void)
+{
+    __atomic_clear(&mem_maps_lock, __ATOMIC_RELEASE);
+}
+
+/* record a new high water mark, called with mem_maps_lock held */
+static void update_peak(void)
+{
+    size_t total = (size_t)(mem_brk - mem_start_brk) + mem_mapped;
+
+    if (total > mem_peak)
+	mem_peak = total;
+}
+
+/* 
+ * mem_init - initialize the memory system model.  The MAX_HEAP bytes
+ *    are reserved without swap backing, so only the pages the heap
+ *    actually touches use memory.
+ */
+void mem_init(void)
+{
+    /* allocate the storage we will use to model the available VM */
+    mem_start_brk = mmap(NULL, MAX_HEAP, PROT_READ | PROT_WRITE,
+			 MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (mem_start_brk == MAP_FAILED) {
+	fprintf(stderr, "mem_init_vm: mmap error\n");
+	exit(1);
+    }
+
+    mem_max_addr = mem_start_brk + MAX_HEAP;  /* max legal heap address */
+    mem_brk = mem_start_brk;                  /* heap is empty initially */
+}
+
+/* 
+ * mem_deinit - free the storage used by the memory system model
+ */
+void mem_deinit(void)
+{
+    munmap(mem_start_brk, MAX_HEAP);
+}
+
+/*
+ * mem_reset_brk - reset the simulated brk pointer to make an empty heap
+ *    and start the high water mark over from zero
+ */
+void mem_reset_brk()
+{
+    maps_lock();
+    mem_brk = mem_start_brk;
+    mem_peak = 0;
+    maps_unlock();
+}
+
+/* 
+ * mem_sbrk - simple model of the sbrk function. Extends the heap 
+ *    by incr bytes and returns the start address of the new area. A
+ *    negative incr shrinks the heap instead and the whole pages that
+ *    fall off its end are given back with mem_discard.
+ */
+void *mem_sbrk(intptr_t incr) 
+{
+    char *old_brk;
+
+    maps_lock();
+    old_brk = mem_brk;
+    if (incr < 0 && (mem_brk - mem_start_brk) < -incr) {
+	maps_unlock();
+	errno = EINVAL;
+	fprintf(stderr, "ERROR: mem_sbrk failed. Cannot shrink below the start of the heap...\n");
+	return (void *)-1;
+    }
+    if (incr > mem_max_addr - mem_brk) {
+	maps_unlock();
+	errno = ENOMEM;
+	fprintf(stderr, "ERROR: mem_sbrk failed. Ran out of memory...\n");
+	return (void *)-1;
+    }
+    mem_brk += incr;
+    update_peak();
+    maps_unlock();
+    if (incr < 0)
+	mem_discard(old_brk + incr, -incr);
+    return (void *)old_brk;
+}
+
+/*
+ * mem_discard - give the whole pages among the size bytes at ptr back
+ *    to the system. The memory stays usable and reads as zeros the
+ *    next time it is touched.
+ */
+void mem_discard(void *ptr, size_t size)
+{
+    size_t pagesize = mem_pagesize();
+    char *lo = (char *)(((size_t)ptr + pagesize - 1) & ~(pagesize - 1));
+    char *hi = (char *)(((size_t)ptr + size) & ~(pagesize - 1));
+
+    if (lo < hi)
+	madvise(lo, hi - lo, MADV_DONTNEED);
+}
+
+/*
+ * mem_map - map size bytes of fresh memory outside the heap, starting
+ *    at a multiple of align (a power of two no smaller than the page
+ *    size). Returns NULL if the memory is not available.
+ */
+void *mem_map(size_t size, size_t align)
+{
+    char *p, *start;
+    map_region_t *r;
+
+    if ((r = (map_region_t *)malloc(sizeof(map_region_t))) == NULL)
+	return NULL;
+    p = mmap(NULL, size + align, PROT_READ | PROT_WRITE,
+	     MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (p == MAP_FAILED) {
+	free(r);
+	return NULL;
+    }
+
+    /* trim the mapping down to the aligned part */
+    start = (char *)(((size_t)p + align - 1) & ~(align - 1));
+    if (start > p)
+	munmap(p, start - p);
+    munmap(start + size, (p + align) - start);
+
+    r->start = start;
+    r->size = size;
+    maps_lock();
+    r->next = mem_maps;
+    mem_maps = r;
+    mem_mapped += size;
+    update_peak();
+    maps_unlock();
+    return (void *)start;
+}
+
+/*
+ * find_region - return the link that points at the record of the
+ *    region starting at ptr, called with mem_maps_lock held
+ */
+static map_region_t **find_region(void *ptr)
+{
+    map_region_t **rp;
+
+    for (rp = &mem_maps; *rp != NULL; rp = &(*rp)->next)
+	if ((*rp)->start == (char *)ptr)
+	    return rp;
+    return NULL;
+}
+
+/*
+ * mem_unmap - release memory obtained from mem_map
+ */
+void mem_unmap(void *ptr, size_t size)
+{
+    map_region_t **rp, *r = NULL;
+
+    maps_lock();
+    if ((rp = find_region(ptr)) != NULL) {
+	r = *rp;
+	*rp = r->next;
+	mem_mapped -= r->size;
+    }
+    maps_unlock();
+    free(r);
+    munmap(ptr, size);
+}
+
+/*
+ * mem_remap - resize a region obtained from mem_map to newsize bytes,
+ *    moving it if need be without copying. Returns the new address or
+ *    NULL if the region cannot be resized, in which case it is left
+ *    as it was.
+ */
+void *mem_remap(void *ptr, size_t oldsize, size_t newsize)
+{
+    map_region_t **rp;
+    char *p;
+
+    p = mremap(ptr, oldsize, newsize, MREMAP_MAYMOVE);
+    if (p == MAP_FAILED)
+	return NULL;
+
+    maps_lock();
+    if ((rp = find_region(ptr)) != NULL) {
+	(*rp)->start = p;
+	(*rp)->size = newsize;
+	mem_mapped += newsize - oldsize;
+	update_peak();
+    }
+    maps_unlock();
+    return (void *)p;
+}
+
+/*
+ * mem_is_mapped - return true if the bytes lo to hi lie within a
+ *    single region obtained from mem_map
+ */
+int mem_is_mapped(void *lo, void *hi)
+{
+    map_region_t *r;
+    int found = 0;
+
+    maps_lock();
+    for (r = mem_maps; r != NULL && !found; r = r->next)
+	found = (char *)lo >= r->start && (char *)hi < r->start + r->size;
+    maps_unlock();
+    return found;
+}
+
+/*
+ * mem_heap_lo - return address of the first heap byte
+ */
+void *mem_heap_lo()
+{
+    return (void *)mem_start_brk;
+}
+
+/* 
+ * mem_heap_hi - return address of last heap byte
+ */
+void *mem_heap_hi()
+{
+    return (void *)(mem_brk - 1);
+}
+
+/*
+ * mem_heapsize() - returns the heap size in bytes
+ */
+size_t mem_heapsize() 
+{
+    return (size_t)(mem_brk - mem_start_brk);
+}
+
+/*
+ * mem_peaksize() - returns the most bytes the heap and the mem_map
+ *    regions have held together since the last mem_reset_brk
+ */
+size_t mem_peaksize()
+{
+    return mem_peak;
+}
+
+/*
+ * mem_pagesize() - returns the page size of the system
+ */
+size_t mem_pagesize()
+{
+    return (size_t)getpagesize();
+}
@@ -0,0 +1,17 @@
+#include <unistd.h>
+
+void mem_init(void);               
+void mem_deinit(void);
+void *mem_sbrk(intptr_t incr);
+void mem_reset_brk(void); 
+void mem_discard(void *ptr, size_t size);
+void *mem_map(size_t size, size_t align);
+void mem_unmap(void *ptr, size_t size);
+void *mem_remap(void *ptr, size_t oldsize, size_t newsize);
+int mem_is_mapped(void *lo, void *hi);
+void *mem_heap_lo(void);
+void *mem_heap_hi(void);
+size_t mem_heapsize(void);
+size_t mem_peaksize(void);
+size_t mem_pagesize(void);
+
@@ -5,12 +5,20 @@
  * use of blocks of data allocated within the heap.  The heap can be expanded as more
  * memory needs to be stored, however the allocator has been optimized to determine if
  * a block can be allocated in free space within the existing heap.  Each block within
- * the heap includes a header and footer designating if the block is allocated, the size
- * of the block, and, if the block is free, pointers to the next and previous free block.
+ * the heap includes a header designating if the block is allocated, if the block before it
+ * is allocated, and the size of the block.  Only free blocks have a footer (a copy of the
+ * size), which is all coalesce needs to find the start of a free previous block, along with
+ * pointers to the next and previous free block.
  * This linked list of pointers, called the free_list, allows the allocator to search for
  * free blocks existing within the heap and determine their respective sizes.  Blocks can 
  * be added/removed from the free list, free blocks can be coalesced, and
- * allocated blocks can be split so that the heap is used more efficiently.
+ * allocated blocks can be split so that the heap is used more efficiently.  By default the
+ * free list is segregated into size classes so a search only has to look at blocks that
+ * are close to the requested size (see FREE_LIST_POLICY below).  Small requests skip the
+ * boundary tags entirely and are carved out of page-sized runs of equal-sized objects
+ * (see SLAB_MAX below).  Built with -DTHREADED=1 the package can be called from several
+ * threads at once: threads are spread over several arenas, each a heap with its own lock, and
+ * each thread caches recently freed small blocks (see the arena and thread support sections).
  */
 #include <stdio.h>
 #include <stdlib.h>
@@ -18,6 +26,19 @@
 #include <unistd.h>
 #include <string.h>
 #include <stdbool.h>
+#include <stdint.h>
+
+#ifndef THREADED
+#define THREADED 0
+#endif
+#if THREADED
+#include <pthread.h>
+#endif
+
+/* Built with -DCHECK=1, entry points also make the argument checks that cost a lookup */
+#ifndef CHECK
+#define CHECK 0
+#endif
 
 #include "mm.h"
 #include "memlib.h"
@@ -48,56 +69,539 @@ team_t team = {
 /* rounds size_t up to align */
 #define SIZE_T_SIZE (ALIGN(sizeof(size_t)))
 
+/*
+ * Block format, chosen at build time.  By default headers and footers are 4-byte words, which
+ * keeps allocated blocks small but caps every block, free ones included, below 4 GiB.  Built
+ * with -DWIDE_HEADERS=1 they are 8-byte words instead, so blocks (and a heap whose free space
+ * coalesces into blocks) can grow past 4 GiB, at the cost of 4 more bytes per block and a
+ * MIN_BLOCK_SIZE of 32.  Block sizes stay multiples of ALIGNMENT either way.
+ */
+#ifndef WIDE_HEADERS
+#define WIDE_HEADERS 0
+#endif
+
 //*****BEGIN TEXTBOOK CODE*****
 //*****CODE BELOW MODIFIED FROM TEXTBOOK*****
 /* Basic constants and macros */
+#if WIDE_HEADERS
+typedef uint64_t word_t;
+#define WSIZE       8       /* Word and header/footer size (bytes) */
+#define DSIZE       16      /* Double word size (bytes) */
+#else
+typedef unsigned int word_t;
 #define WSIZE       4       /* Word and header/footer size (bytes) */
 #define DSIZE       8       /* Double word size (bytes) */
+#endif
 #define CHUNKSIZE  (1<<12)  /* Extend heap by this amount (bytes) */
 
 /* returns greater of two inputs */
 #define MAX(x, y) ((x) > (y)? (x) : (y))
 
+/* returns lesser of two inputs */
+#define MIN(x, y) ((x) < (y)? (x) : (y))
+
 /* Pack a size and allocated bit into a word */
 #define PACK(size, alloc)  ((size) | (alloc))
 
+/* Header bit set when the previous block is allocated (and so has no footer) */
+#define PREV_ALLOC 0x2
+
 /* Read and write a word at address p */
-#define GET(p)       (*(unsigned int *)(p))
-#define PUT(p, val)  (*(unsigned int *)(p) = (val))
+#define GET(p)       (*(word_t *)(p))
+#define PUT(p, val)  (*(word_t *)(p) = (val))
 
 /* Read the size and allocated fields from address p */
 #define GET_SIZE(p)  (GET(p) & ~0x7)
 #define GET_ALLOC(p) (GET(p) & 0x1)
+#define GET_PREV_ALLOC(p) (GET(p) & PREV_ALLOC)
+
+/* Read and write a header that a thread without the arena's lock may be reading (see
+   block_chunk_size) */
+#define GET_SHARED(p)       __atomic_load_n((word_t *)(p), __ATOMIC_RELAXED)
+#define PUT_SHARED(p, val)  __atomic_store_n((word_t *)(p), (val), __ATOMIC_RELAXED)
 
-/* Given block ptr bp, compute address of its header and footer */
+/* Set or clear the prev-alloc bit of the header at address p */
+#define SET_PREV_ALLOC(p)   PUT_SHARED(p, GET(p) | PREV_ALLOC)
+#define CLEAR_PREV_ALLOC(p) PUT_SHARED(p, GET(p) & ~PREV_ALLOC)
+
+/* Given block ptr bp, compute address of its header and footer (free blocks only) */
 #define HDRP(bp) ((char *)(bp) - WSIZE)
 #define FTRP(bp) ((char *)(bp) + GET_SIZE(HDRP(bp)) - DSIZE)
 
-/* Given block ptr bp, compute address of next and previous blocks */
+/* Given block ptr bp, compute address of next and previous blocks (previous must be free) */
 #define NEXT_BLKP(bp) ((char *)(bp) + GET_SIZE(((char *)(bp) - WSIZE)))
 #define PREV_BLKP(bp) ((char *)(bp) - GET_SIZE(((char *)(bp) - DSIZE)))
 
-#define GET_NEXT_PTR(bp)  (*(char **)(bp + WSIZE))
+/*
+ * Free list links, chosen at build time.  By default they are plain pointers.  Built with
+ * -DCOMPRESSED_LINKS=1 they are 32-bit offsets from the start of the current arena's heap,
+ * counted in ALIGNMENT units with 0 standing for null, which takes MIN_BLOCK_SIZE from 24
+ * bytes down to 16 (32 to 24 with WIDE_HEADERS).  Offsets reach LINK_RANGE bytes into a heap,
+ * and arena_sbrk does not grow a heap past that, a limit only 64-bit builds can reach.
+ */
+#ifndef COMPRESSED_LINKS
+#define COMPRESSED_LINKS 0
+#endif
+
+#if COMPRESSED_LINKS
+#define LINK_SIZE  4
+#define LINK_RANGE ((uint64_t)ALIGNMENT << 32)
+
+/* Convert between a link and the block it refers to, within the current arena */
+#define LINK_TO_PTR(off) ((off) ? arena->heap_start + (size_t)(off) * ALIGNMENT : NULL)
+#define PTR_TO_LINK(qp)  ((qp) ? (unsigned int)(((char *)(qp) - arena->heap_start) / ALIGNMENT) : 0)
+
+/* Free block links: prev link at the start of the payload, next link right after it */
+#define GET_NEXT_PTR(bp)  LINK_TO_PTR(*(unsigned int *)((char *)(bp) + LINK_SIZE))
+#define GET_PREV_PTR(bp)  LINK_TO_PTR(*(unsigned int *)(bp))
+
+/* Puts links to qp in the next and previous elements of free list */
+#define SET_NEXT_PTR(bp, qp) (*(unsigned int *)((char *)(bp) + LINK_SIZE) = PTR_TO_LINK(qp))
+#define SET_PREV_PTR(bp, qp) (*(unsigned int *)(bp) = PTR_TO_LINK(qp))
+#else
+#define LINK_SIZE  sizeof(char *)
+
+/* Free block links: prev pointer at the start of the payload, next pointer right after it */
+#define GET_NEXT_PTR(bp)  (*(char **)((char *)(bp) + LINK_SIZE))
 #define GET_PREV_PTR(bp)  (*(char **)(bp))
 
 /* Puts pointers in the next and previous elements of free list */
 #define SET_NEXT_PTR(bp, qp) (GET_NEXT_PTR(bp) = qp)
 #define SET_PREV_PTR(bp, qp) (GET_PREV_PTR(bp) = qp)
+#endif
 
-static char *heap_listp = 0;
+/* Smallest legal block: header, footer and room for both free list links */
+#define MIN_BLOCK_SIZE ALIGN(DSIZE + 2 * LINK_SIZE)
+
+/* Size of the block that holds a payload of size bytes: header plus payload, rounded up */
+#define ADJUSTED_SIZE(size) MAX(MIN_BLOCK_SIZE, ALIGN((size) + WSIZE))
 
 //*****End Textbook Code*****
 
+/*
+ * Free list policy, chosen at build time (e.g. make CFLAGS+=-DFREE_LIST_POLICY=EXPLICIT_LIST).
+ * EXPLICIT_LIST keeps every free block on a single LIFO list that find_fit searches first-fit.
+ * SEGREGATED_LIST keeps one such list per power-of-two size class, and find_fit starts at the
+ * smallest class that can hold the request.  TLSF_INDEX splits every power of two into
+ * SL_COUNT lists and keeps a two-level bitmap of the non-empty ones, so find_fit picks a
+ * list with two find-first-set operations and takes its head without walking anything.
+ * BEST_FIT_TREE keeps blocks under TREE_MIN on exact-size lists and every larger block in a
+ * red-black tree ordered by (size, address), so find_fit returns the smallest, lowest
+ * addressed block that fits in O(log n).
+ */
+#define EXPLICIT_LIST   0
+#define SEGREGATED_LIST 1
+#define TLSF_INDEX      2
+#define BEST_FIT_TREE   3
+
+#ifndef FREE_LIST_POLICY
+#define FREE_LIST_POLICY SEGREGATED_LIST
+#endif
+
+#if FREE_LIST_POLICY == SEGREGATED_LIST
+#define NUM_CLASSES 20      /* class 0 holds blocks under 32 bytes, the last one everything else */
+#elif FREE_LIST_POLICY == TLSF_INDEX
+#define SL_LOG2     3                         /* second-level lists per power of two (log2) */
+#define SL_COUNT    (1 << SL_LOG2)
+#define FL_SHIFT    (SL_LOG2 + 3)             /* blocks under 1 << FL_SHIFT all share fl 0 */
+#define FL_COUNT    (8 * WSIZE - FL_SHIFT + 1) /* enough for any size a header can hold */
+#define NUM_CLASSES (FL_COUNT * SL_COUNT)
+#elif FREE_LIST_POLICY == BEST_FIT_TREE
+#define TREE_MIN    256                       /* smallest block kept in the tree */
+#define NUM_CLASSES (TREE_MIN / ALIGNMENT)    /* one list per block size below TREE_MIN */
+#else
+#define NUM_CLASSES 1
+#endif
+
+/* Index of the highest and lowest set bit of a nonzero value */
+#define FLS(x) ((int)(8 * sizeof(unsigned long) - 1 - __builtin_clzl(x)))
+#define FFS(x) (__builtin_ctzl(x))
+
 /* Helper Function Declarations */
-static char *free_list_start = 0;
+#if FREE_LIST_POLICY == BEST_FIT_TREE
+/* Tree node fields, stored in the payload of a free block in place of the list links */
+#define TREE_LEFT(bp)   (*(char **)(bp))
+#define TREE_RIGHT(bp)  (*(char **)((char *)(bp) + sizeof(char *)))
+#define TREE_PARENT(bp) (*(char **)((char *)(bp) + 2 * sizeof(char *)))
+#define TREE_COLOR(bp)  (*(unsigned int *)((char *)(bp) + 3 * sizeof(char *)))
+#define RED   1
+#define BLACK 0
+#define IS_RED(bp) ((bp) != NULL && TREE_COLOR(bp) == RED)
+
+/* Tree order: by size, then by address */
+#define TREE_LESS(bp, qp) (GET_SIZE(HDRP(bp)) < GET_SIZE(HDRP(qp)) || \
+                           (GET_SIZE(HDRP(bp)) == GET_SIZE(HDRP(qp)) && (char *)(bp) < (char *)(qp)))
+
+static void tree_insert(char *bp);
+static void tree_remove(char *bp);
+static char *tree_search(size_t asize);
+#endif
+static int size_class(size_t size);
 static void *coalesce(void *bp);
 static void *extend_heap(size_t words);
 static void *find_fit(size_t asize);
 static void place(void *bp, size_t asize);
 static void insert_in_free_list(void *bp);
 static void remove_from_free_list(void *bp);
+static void *alloc_block(size_t size);
+static void free_block(void *bp);
+static void *heap_malloc(size_t size);
+static void heap_free(void *bp);
+static void heap_free_block(void *bp);
+static void *fit_block(size_t asize);
+static void *aligned_block(size_t asize, size_t align, size_t base);
+static char *aligned_spot(char *bp, size_t align, size_t base);
+static size_t heap_malloc_batch(size_t size, size_t n, void **ptrs);
+static void place_batch(void *bp, size_t asize, size_t k, void **ptrs);
+static void heap_free_batch(void **ptrs, size_t n);
+static void ptrs_sort(void **ptrs, size_t n);
+static int ptr_compare(const void *a, const void *b);
+static void *heap_realloc(void *bp, size_t size);
+static void realloc_split(void *bp, size_t asize);
+static void *realloc_move(void *bp, size_t size, size_t copy);
 //static void mm_check(void *bp, int size);
 
+/*
+ * Slab layer: requests of at most SLAB_MAX bytes are served from runs, RUN_SIZE-byte pages
+ * of the heap (aligned relative to heap_start) that hold objects of a single size class with
+ * no per-object header or footer.  Each run is an allocated block of exactly RUN_SIZE bytes
+ * whose payload starts on a page boundary, so its header ends the page before it and the
+ * next block's header ends its own page; back to back runs leave no gaps.
+ * The payload begins with a run_t and the objects follow it.  A run keeps its freed objects
+ * on a list threaded through their first word, and runs with at least one free object sit
+ * on partial_runs for their class.  run_map has a bit per heap page that is set when the
+ * page is a run, so mm_free can tell a slab object from a block by its address alone.  The
+ * map lives in a mapping of its own rather than in the heap, where it could hold up trimming.
+ * In THREADED builds is_slab reads it without the arena's lock, so a map that has to grow is
+ * replaced, with its size, by a single atomic pointer store, and its bits are read and
+ * written with atomic byte accesses.  slab_free keeps an empty run per class; mm_trim hands
+ * those back too.
+ * Build with -DSLAB_MAX=0 to turn the layer off.
+ */
+#ifndef SLAB_MAX
+#define SLAB_MAX 128
+#endif
+
+#if SLAB_MAX > 0
+#define RUN_SIZE     4096
+#define SLAB_CLASSES (SLAB_MAX / ALIGNMENT)
+#define RUN_HDR_SIZE ALIGN(sizeof(run_t))
+
+typedef struct run {
+  struct run *next;     /* neighbours on the partial_runs list of this class */
+  struct run *prev;
+  char *free;           /* objects freed back to this run */
+  char *unused;         /* first object that has never been handed out */
+  unsigned int objsize; /* bytes per object */
+  unsigned int nfree;   /* free objects, including the never used ones */
+} run_t;
+
+typedef struct run_map {
+  size_t pages;           /* number of pages the map covers */
+  struct run_map *prev;   /* map this one replaced, kept for readers in THREADED builds */
+  unsigned char bits[];   /* bit per heap page, set if the page is a run */
+} run_map_t;
+
+/* Bytes of the mapping of a run map that covers pages pages */
+#define RUN_MAP_LENGTH(pages) (sizeof(run_map_t) + (pages) / 8)
+
+/* Page index of p within the heap, and the run that contains slab object p */
+#define PAGE_INDEX(p) ((size_t)((char *)(p) - arena->heap_start) / RUN_SIZE)
+#define RUN_OF(p)     ((run_t *)(arena->heap_start + PAGE_INDEX(p) * RUN_SIZE))
+#define RUN_CAPACITY(run) ((RUN_SIZE - WSIZE - RUN_HDR_SIZE) / (run)->objsize)
+
+static int is_slab(void *bp);
+static void *slab_alloc(size_t size);
+static void slab_free(void *bp);
+static void slab_trim(void);
+static void run_maps_release(void);
+#endif
+
+/*
+ * Deferred coalescing: heap_free does not hand blocks of at most FASTBIN_MAX bytes to
+ * free_block when both their neighbours are allocated.  It pushes them onto the fast bin for
+ * their exact size, a LIFO list linked through the first word of the payload, and leaves them
+ * marked allocated, so nothing merges with them and alloc_block can return one to a request
+ * of that size without splitting or searching.  Churn of a single size then stops merging
+ * and splitting the same neighbours over and over.  fast_consolidate runs free_block on every
+ * fast block, merging them with each other and with their free neighbours, when a bin passes
+ * FASTBIN_LIMIT blocks, when find_fit comes up empty (before the heap is grown) and, as in
+ * glibc, when a block of FAST_CONSOLIDATE_SIZE or more is freed, so the heap can still be
+ * trimmed once a program lets go of most of it; mm_trim consolidates too.  The slab layer
+ * already covers small requests, so the bins matter for the block sizes just above it.  Build
+ * with -DFASTBIN_MAX=0 to turn deferred coalescing off.
+ */
+#ifndef FASTBIN_MAX
+#define FASTBIN_MAX 512
+#endif
+
+#if FASTBIN_MAX > 0
+#define FASTBINS      (FASTBIN_MAX / ALIGNMENT + 1)
+#define FASTBIN_LIMIT 32
+#define FAST_CONSOLIDATE_SIZE (64 * 1024)   /* freeing a block this big consolidates */
+#define FASTBIN(size) ((size) / ALIGNMENT)  /* bin of blocks of size bytes */
+
+static bool fast_push(void *bp);
+static void *fast_pop(size_t asize);
+static void fast_consolidate(void);
+#endif
+
+/*
+ * Arenas: everything that describes a heap (its bounds, free lists and runs) lives in an
+ * arena_t, and the functions above work on whichever arena the arena pointer names.  Plain
+ * builds have a single arena, main_arena, whose heap memlib grows with mem_sbrk.  THREADED
+ * builds add up to NUM_ARENAS - 1 more, created on demand.  Each is an ARENA_SIZE-aligned
+ * reservation from mem_map that starts with its arena_t, followed by a heap that arena_sbrk
+ * grows by moving brk toward the end of the reservation.  Threads are handed arenas round
+ * robin on their first malloc and each arena has its own lock, so threads on different
+ * arenas never wait for each other.  arena_of finds the arena of any block from its address:
+ * blocks inside memlib's heap belong to main_arena and any other block to the arena at the
+ * ARENA_SIZE boundary below it, if there is one there.  A request that an extra arena has no
+ * room left for is served by main_arena instead.
+ */
+#ifndef NUM_ARENAS
+#define NUM_ARENAS (THREADED ? 8 : 1)
+#endif
+#define ARENA_SIZE (1 << 26)        /* bytes reserved for each extra arena */
+
+typedef struct {
+  char *heap_start;                 /* first byte of the heap, what runs are aligned against */
+  char *brk;                        /* one past the last byte of the heap */
+  char *end;                        /* end of the reservation (extra arenas) */
+  bool trimmed;                     /* heap was trimmed and has not grown since */
+  size_t reserved;                  /* slack bytes held by reserved blocks */
+  size_t chunk;                     /* what grow_heap extends the heap by at least */
+  size_t last_grow;                 /* bytes the last extension added */
+  size_t allocated;                 /* bytes carved out of free blocks since then */
+#if FASTBIN_MAX > 0
+  char *fastbins[FASTBINS];         /* freed blocks waiting to be coalesced, by size */
+  unsigned int fast_count[FASTBINS];
+  unsigned int fast_blocks;         /* blocks in all the fast bins */
+#endif
+  char *free_lists[NUM_CLASSES];    /* heads of the free lists, NULL terminated */
+#if FREE_LIST_POLICY == TLSF_INDEX
+  unsigned long fl_bitmap;          /* bit fl set if any list of first level fl is non-empty */
+  unsigned int sl_bitmap[FL_COUNT]; /* bit sl set if list (fl, sl) is non-empty */
+#endif
+#if FREE_LIST_POLICY == BEST_FIT_TREE
+  char *tree_root;
+#endif
+#if SLAB_MAX > 0
+  run_t *partial_runs[SLAB_CLASSES];
+  run_map_t *run_map;               /* which heap pages are runs, NULL until the first run */
+#endif
+#if THREADED
+  pthread_mutex_t lock;
+  char *remote_frees;               /* blocks freed by other threads, waiting for the lock */
+  unsigned int remote_count;        /* number of them */
+#endif
+} arena_t;
+
+/* Where the heap of an extra arena starts */
+#define ARENA_HEAP(a) ((char *)(a) + ALIGN(sizeof(arena_t)))
+
+#if THREADED
+static arena_t main_arena = { .lock = PTHREAD_MUTEX_INITIALIZER };
+static arena_t *arenas[NUM_ARENAS] = { &main_arena };
+static unsigned int next_arena;                    /* round robin counter for new threads */
+static pthread_mutex_t arenas_lock = PTHREAD_MUTEX_INITIALIZER;
+static __thread arena_t *arena;                    /* arena this thread is working on */
+static __thread arena_t *thread_arena;             /* arena this thread allocates from */
+
+#define LOCK(a)   pthread_mutex_lock(&(a)->lock)
+#define UNLOCK(a) pthread_mutex_unlock(&(a)->lock)
+
+static arena_t *get_thread_arena(void);
+#else
+static arena_t main_arena;
+static arena_t *arena = &main_arena;
+
+#define LOCK(a)
+#define UNLOCK(a)
+#endif
+static arena_t *arena_of(void *bp);
+static void *arena_sbrk(size_t incr);
+static int arena_init(void);
+
+/*
+ * Large blocks: requests of at least mmap_threshold bytes get a mapping of their own from
+ * mem_map instead of a block in an arena, so freeing one hands its pages straight back rather
+ * than leaving a hole in a heap that can only shrink from the top.  The mapping begins with a
+ * padding word and the block's header, whose size is the length of the whole mapping, and the
+ * payload follows at MAP_HDR_SIZE.  A block mm_memalign maps for a larger alignment starts
+ * MAP_LEAD bytes into its mapping instead, and records that lead in the padding word (which is
+ * 0 otherwise).  Since such a block lies outside every arena, arena_of returns null for it.
+ * mm_realloc resizes a mapped block with mem_remap, which moves pages instead of copying them.
+ * The threshold starts at MMAP_THRESHOLD and adapts to the frees it sees: freeing a mapped
+ * block bigger than the threshold raises the threshold to that block's size (up to
+ * MMAP_THRESHOLD_MAX), because a size the program keeps allocating and freeing is cheaper to
+ * recycle inside the heap than to map and unmap every time.
+ */
+#define MMAP_THRESHOLD     (128 * 1024)
+#define MMAP_THRESHOLD_MAX (32 * 1024 * 1024)
+#define MAP_HDR_SIZE       DSIZE
+
+#define MAP_MAX            ((size_t)1 << (8 * WSIZE - 1))   /* largest request a header can describe */
+
+/* Length of the mapping for a large block of size bytes */
+#define MAP_LENGTH(size) (((size) + MAP_HDR_SIZE + mem_pagesize() - 1) & ~(mem_pagesize() - 1))
+
+/* Bytes of the mapping of large block bp in front of its MAP_HDR_SIZE */
+#define MAP_LEAD(bp) GET((char *)(bp) - DSIZE)
+
+static size_t mmap_threshold = MMAP_THRESHOLD;
+
+static void *map_block(size_t size, size_t align);
+static void unmap_block(void *bp);
+static void *remap_block(void *bp, size_t size);
+
+/*
+ * Trimming: a heap gives memory back from its top only.  When free_block leaves more than
+ * trim_threshold free bytes at the top of an arena, heap_trim shrinks the heap until only
+ * TRIM_PAD bytes of that block remain, so a program does not hold on to its peak heap forever.
+ * Like glibc, trim_threshold tracks mmap_threshold at twice its value, so the sizes that were
+ * moved into the heap do not get trimmed and regrown on every free.  It also doubles (up to
+ * TRIM_THRESHOLD_MAX) whenever an arena has to grow again after a trim, since the memory given
+ * back turned out to be needed, which stops a heap from oscillating.  mm_trim does the same for
+ * every arena on request with a pad of the caller's choosing, and also hands back the whole
+ * pages inside large free blocks further down the heaps.
+ */
+#ifndef TRIM_THRESHOLD
+#define TRIM_THRESHOLD (2 * MMAP_THRESHOLD)
+#endif
+#ifndef TRIM_PAD
+#define TRIM_PAD       CHUNKSIZE
+#endif
+#define TRIM_THRESHOLD_MAX (64 * 1024 * 1024)
+
+static size_t trim_threshold = TRIM_THRESHOLD;
+
+static void arena_shrink(size_t decr);
+static size_t heap_trim(size_t pad);
+static size_t heap_discard(void);
+
+/*
+ * Heap growth: when nothing in the free lists fits, grow_heap extends the heap by the arena's
+ * current chunk, or by the request if that is bigger, instead of a fixed CHUNKSIZE.  The chunk
+ * adapts to what happened since the last extension.  If less than GROW_BURST times that
+ * extension was carved out of free blocks, the heap is growing steadily and the chunk doubles,
+ * so a burst of allocations takes a few calls to mem_sbrk instead of one per CHUNKSIZE.  If
+ * more than GROW_STABLE times as much was, the heap has mostly been recycling its own blocks
+ * and the chunk halves back toward CHUNKSIZE.  The chunk never exceeds 1/GROW_SHARE of the
+ * heap, which bounds what a heap can hold unused at its top at its peak, nor CHUNK_MAX, which
+ * stays below TRIM_THRESHOLD so a fresh chunk is not trimmed away on the next free.
+ */
+#define CHUNK_MAX   (TRIM_THRESHOLD / 2)
+#define GROW_BURST  2
+#define GROW_STABLE 8
+#ifndef GROW_SHARE
+#define GROW_SHARE  16
+#endif
+
+static void *grow_heap(size_t size);
+
+/*
+ * Realloc reserves: a block that mm_realloc has to grow by a step (at most half its size, as
+ * opposed to a jump to an unrelated size) gets room to grow again.  Wherever it grows, other
+ * than at the top of the heap where growing is free anyway, it is given RESERVE_SIZE(asize)
+ * bytes instead of asize, half as much again (up to RESERVE_MAX more, and never enough to
+ * cross mmap_threshold on a move), so a block that keeps growing by small steps only outgrows
+ * its block every few calls and the slack grows geometrically with the block.  Such a block
+ * has RESERVED set in its header and keeps the block size it actually uses in its last word,
+ * which lies in the slack; a later realloc that fits the slack just updates that word.
+ * The slack is not lost to other requests: when find_fit comes up empty and the arena's
+ * reserves add up to at least the request, reserve_reclaim cuts every reserved block back to
+ * its used size and frees the tails, which coalesce with their free neighbours, before the
+ * heap is grown.  mm_trim reclaims them too, and freeing a reserved block frees its slack
+ * with it.
+ */
+#define RESERVED    0x4
+#define RESERVE_MAX (64 * 1024)
+
+/* Block size mm_realloc gives a block that grows to asize bytes, and whether growing from
+   used to asize bytes is a step */
+#define RESERVE_SIZE(asize) ((asize) + MIN(ALIGN((asize) / 2), RESERVE_MAX))
+#define GROWS_BY_STEP(used, asize) ((asize) - (used) <= (used) / 2)
+
+/* Whether the block with header p is reserved, and the size reserved block bp uses */
+#define GET_RESERVED(p)   (GET(p) & RESERVED)
+#define RESERVE_USED(bp)  GET(FTRP(bp))
+
+static void reserve_set(void *bp, size_t used);
+static size_t reserve_clear(void *bp);
+static void reserve_reclaim(void);
+
+/*
+ * Regions: for memory that all dies at once, mm_region_create makes a region that
+ * mm_region_alloc carves objects out of by bumping a pointer through a chunk, with no header
+ * per object and nothing to free one by one.  Chunks come from mm_malloc, starting at
+ * REGION_CHUNK bytes and doubling up to REGION_CHUNK_MAX, and begin with a link to the chunk
+ * before them; the mm_region_t itself sits at the front of the first one.  A request too big
+ * for half a chunk gets a chunk of its own, linked in behind the current one so the space left
+ * there is not thrown away.  mm_region_destroy hands the chunks back with one mm_free each,
+ * so a region of thousands of objects costs a handful of frees.  Objects of a region must not
+ * be passed to mm_free or mm_realloc, and a region must not be used by two threads at once.
+ */
+#define REGION_CHUNK     (8 * 1024)
+#define REGION_CHUNK_MAX (1024 * 1024)
+#define CHUNK_HDR_SIZE   ALIGN(sizeof(char *))
+
+struct mm_region {
+  char *chunks;                     /* newest chunk, each one linked to the one before */
+  char *next;                       /* bump pointer into the newest chunk */
+  char *end;                        /* end of the newest chunk */
+  size_t chunk_size;                /* size of the next chunk */
+};
+
+static void *region_grow(mm_region_t *r, size_t size);
+
+/*
+ * Thread support (THREADED builds): every entry point that touches a heap holds the lock of
+ * its arena.  In front of that, each thread keeps a cache (tcache) of blocks it freed, binned
+ * by chunk size (slab object size or block size) up to TCACHE_MAX bytes.  Cached blocks stay
+ * allocated as far as the heap is concerned and are linked through their first word, so
+ * mm_malloc and mm_free of small sizes usually take no lock at all.  When a bin passes
+ * TCACHE_COUNT blocks, TCACHE_BATCH of them go back to their arenas under one lock per arena;
+ * this is also how blocks freed by a thread other than the one that allocated them return.  A
+ * thread's cache is flushed when the thread exits.  mm_init must run before other threads
+ * start using the package.
+ * With REMOTE_FREE (the default) a block freed by a thread that does not allocate from its
+ * arena skips the cache and the lock: it is pushed with a compare-and-swap onto the arena's
+ * remote_frees stack, and the next thread to take the arena's lock (in mm_malloc, mm_free, a
+ * cache flush, mm_free_batch or mm_trim) pops the whole stack with one atomic exchange and
+ * frees the blocks for real.  An arena that no thread allocates from may not see its lock
+ * taken for a long time, so once REMOTE_LIMIT blocks are waiting, the thread that pushes one
+ * takes the lock itself if it is free and drains the stack.  Since only lock holders pop, and
+ * they take everything, the stack needs no ABA protection.
+ */
+#if THREADED
+#ifndef REMOTE_FREE
+#define REMOTE_FREE 1
+#endif
+
+#define REMOTE_LIMIT 256
+
+#define TCACHE_MAX   512
+#define TCACHE_BINS  (TCACHE_MAX / ALIGNMENT)
+#define TCACHE_COUNT 32
+#define TCACHE_BATCH 16
+
+typedef struct {
+  char *head[TCACHE_BINS];          /* cached blocks of chunk size (i + 1) * ALIGNMENT */
+  unsigned int count[TCACHE_BINS];
+  int registered;                   /* exit destructor set up for this thread */
+} tcache_t;
+
+static __thread tcache_t tcache;
+static pthread_key_t tcache_key;
+static pthread_once_t tcache_once = PTHREAD_ONCE_INIT;
+
+static size_t block_chunk_size(void *bp);
+static void tcache_release(void *arg);
+static void remote_push(void *bp);
+static void remote_drain(void);
+#endif
+
 //*****Begin Textbook Code*****
 
 /*
@@ -108,8 +612,8 @@ static void remove_from_free_list(void *bp);
  */
 static void *coalesce(void *bp)
 {
-  size_t prev_alloc = GET_ALLOC(FTRP(PREV_BLKP(bp))) || PREV_BLKP(bp) == bp;
-  size_t next_alloc = GET_ALLOC(HDRP(NEXT_BLKP(bp))) // || NEXT_BLKP(bp) == bp;
+  size_t prev_alloc = GET_PREV_ALLOC(HDRP(bp));
+  size_t next_alloc = GET_ALLOC(HDRP(NEXT_BLKP(bp))); // || NEXT_BLKP(bp) == bp;
                                                      // ^ condition written to prevent coalescing over top of heap, but excluding improved throughput without causing seg error
  
   size_t size = GET_SIZE(HDRP(bp));
@@ -122,21 +626,21 @@ static void *coalesce(void *bp)
  else if (prev_alloc && !next_alloc) {       // Case 2
       size += GET_SIZE(HDRP(NEXT_BLKP(bp)));
       remove_from_free_list(NEXT_BLKP(bp));
-      PUT(HDRP(bp), PACK(size, 0));
+      PUT(HDRP(bp), PACK(size, 0) | PREV_ALLOC);
       PUT(FTRP(bp), PACK(size,0));
       }
  else if (!prev_alloc && next_alloc) {       // Case 3
       size += GET_SIZE(HDRP(PREV_BLKP(bp)));
+      remove_from_free_list(PREV_BLKP(bp));
       PUT(FTRP(bp), PACK(size, 0));
-      PUT(HDRP(PREV_BLKP(bp)), PACK(size, 0));
+      PUT(HDRP(PREV_BLKP(bp)), PACK(size, 0) | PREV_ALLOC);
       bp = PREV_BLKP(bp);
-      remove_from_free_list(bp);
     }
     else {      // Case 4
       size += GET_SIZE(HDRP(PREV_BLKP(bp))) + GET_SIZE(FTRP(NEXT_BLKP(bp)));
       remove_from_free_list(PREV_BLKP(bp));
       remove_from_free_list(NEXT_BLKP(bp));
-      PUT(HDRP(PREV_BLKP(bp)), PACK(size, 0));
+      PUT(HDRP(PREV_BLKP(bp)), PACK(size, 0) | PREV_ALLOC);
       PUT(FTRP(NEXT_BLKP(bp)), PACK(size, 0));
       bp = PREV_BLKP(bp);
     }
@@ -147,7 +651,7 @@ static void *coalesce(void *bp)
 
 /*
  * extend_heap: If more heap memory is needed, extend_heap adds free space to the top of
- * the heap.  Calls mem_sbrk to expand the heap by the number of bytes necessary to store
+ * the heap.  Calls arena_sbrk to expand the heap by the number of bytes necessary to store
  * the given number of words while maintaining alignment. Sets correct headers and footers
  * and coalesces if previous block is free.
  */
@@ -159,14 +663,14 @@ static void *extend_heap(size_t words)
   /* Allocate an even number of words to maintain alignment */
   size = (words % 2) ? (words+1) * WSIZE : words * WSIZE;
     
-  if (size < 16)
-    size = 16;
+  if (size < MIN_BLOCK_SIZE)
+    size = MIN_BLOCK_SIZE;
     
-  if ((long)(bp = mem_sbrk(size)) == -1)
+  if ((long)(bp = arena_sbrk(size)) == -1)
     return NULL;
     
   /* Initialize free block header/footer and the epilogue header */
-  PUT(HDRP(bp), PACK(size, 0)); /* Free block header */
+  PUT(HDRP(bp), PACK(size, 0) | GET_PREV_ALLOC(HDRP(bp))); /* Free block header, in place of the old epilogue */
   PUT(FTRP(bp), PACK(size, 0)); /* Free block footer */
   PUT(HDRP(NEXT_BLKP(bp)), PACK(0, 1)); /* New epilogue header */
     
@@ -176,207 +680,2075 @@ static void *extend_heap(size_t words)
 //*****End Textbook Code*****
 
 /*
- * find_fit: Iterates through free_list to find a free block with size >= asize.  If no fit
- * is found, returns null.
+ * grow_heap: Extends the current arena's heap for a request of size bytes, adapting the arena's
+ * chunk first (see Heap growth), and returns the free block at the top of the heap, or null.
+ * An arena that has no room for a whole chunk is extended by just size bytes.
+ */
+static void *grow_heap(size_t size){
+  size_t extendsize;
+  void *bp;
+
+  if (arena->allocated < GROW_BURST * arena->last_grow)
+    arena->chunk = MIN(2 * arena->chunk, CHUNK_MAX);
+  else if (arena->allocated > GROW_STABLE * arena->last_grow)
+    arena->chunk = MAX(arena->chunk / 2, CHUNKSIZE);
+  arena->chunk = MAX(MIN(arena->chunk, (size_t)(arena->brk - arena->heap_start) / GROW_SHARE),
+                     CHUNKSIZE);
+
+  extendsize = MAX(size, arena->chunk);
+  if ((bp = extend_heap(extendsize / WSIZE)) == NULL) {
+    if (extendsize == size || (bp = extend_heap(size / WSIZE)) == NULL)
+      return NULL;
+    extendsize = size;
+  }
+  arena->last_grow = extendsize;
+  arena->allocated = 0;
+  return bp;
+}
+
+/*
+ * size_class: Returns the index of the free list that blocks of the given size belong to.
+ * Class 0 holds blocks smaller than 32 bytes and each following class doubles the bound.
+ * Under TLSF_INDEX the index is fl * SL_COUNT + sl, where fl is the power of two below the
+ * size and sl the next SL_LOG2 bits of the size.
+ */
+static int size_class(size_t size){
+#if FREE_LIST_POLICY == TLSF_INDEX
+  int fl, sl;
+
+  if (size < (1 << FL_SHIFT)) {
+    fl = 0;
+    sl = size >> (FL_SHIFT - SL_LOG2);
+  }
+  else {
+    fl = FLS(size);
+    sl = (size >> (fl - SL_LOG2)) ^ SL_COUNT;
+    fl -= FL_SHIFT - 1;
+  }
+  return fl * SL_COUNT + sl;
+#elif FREE_LIST_POLICY == BEST_FIT_TREE
+  return size / ALIGNMENT;
+#else
+  int class = 0;
+
+  if (NUM_CLASSES == 1)
+    return 0;
+  size >>= 5;
+  while (size > 0 && class < NUM_CLASSES - 1) {
+    size >>= 1;
+    class++;
+  }
+  return class;
+#endif
+}
+
+/*
+ * find_fit: Iterates through the free lists, starting with the size class of asize, to
+ * find a free block with size >= asize.  Every block in a larger class is big enough, so
+ * only the first class searched can be skipped over.  If no fit is found, returns null.
  */
 static void *find_fit(size_t asize){
-  void *bp = free_list_start;
+  void *bp;
+  int class;
   if (asize == 0) {
     return NULL;
   }
-  while (GET_ALLOC(HDRP(bp)) == 0) {
-    if (asize <= GET_SIZE(HDRP(bp))) {
-      return bp;
+#if FREE_LIST_POLICY == BEST_FIT_TREE
+  if (asize >= TREE_MIN)
+    return tree_search(asize);
+#endif
+#if FREE_LIST_POLICY == TLSF_INDEX
+  {
+    unsigned long map;
+    int fl, sl;
+
+    /* Round asize up to the next list boundary so any block in that list or above fits */
+    if (asize >= (1 << FL_SHIFT))
+      asize += ((size_t)1 << (FLS(asize) - SL_LOG2)) - 1;
+    class = size_class(asize);
+    fl = class / SL_COUNT;
+    sl = class % SL_COUNT;
+    if (fl >= FL_COUNT)
+      return NULL;
+
+    /* First non-empty list at this first level, else the first non-empty level above it */
+    map = arena->sl_bitmap[fl] & (~0U << sl);
+    if (map == 0) {
+      map = arena->fl_bitmap & (~0UL << (fl + 1));
+      if (map == 0)
+        return NULL;
+      fl = FFS(map);
+      map = arena->sl_bitmap[fl];
     }
-    bp = GET_NEXT_PTR(bp);
+    return arena->free_lists[fl * SL_COUNT + FFS(map)];
   }
+#endif
+  for (class = size_class(asize); class < NUM_CLASSES; class++) {
+    for (bp = arena->free_lists[class]; bp != NULL; bp = GET_NEXT_PTR(bp)) {
+      if (asize <= GET_SIZE(HDRP(bp))) {
+        return bp;
+      }
+    }
+  }
+#if FREE_LIST_POLICY == BEST_FIT_TREE
+  return tree_search(asize);
+#else
   return NULL;
+#endif
 }
 /*
  * place: puts requested block at beginning of the free block.  If remaining space in newly
- * allocated block is at least the size of the minimum free block (4 bytes), then split
- * block so unallocated part can be used as its own free block.
+ * allocated block is at least the size of the minimum free block, then split block so
+ * unallocated part can be used as its own free block.  Otherwise the whole block is used and
+ * the next block is told its previous block is now allocated.
  */
 
 static void place(void *bp, size_t asize) {
   size_t csize = GET_SIZE(HDRP(bp));
+  size_t prev_alloc = GET_PREV_ALLOC(HDRP(bp));
     
-  if ((csize - asize) >= 4 * WSIZE) {
-    PUT(HDRP(bp), PACK(asize, 1));
-    PUT(FTRP(bp), PACK(asize, 1));
-    remove_from_free_list(bp);
+  remove_from_free_list(bp);
+  arena->allocated += asize;
+  if ((csize - asize) >= MIN_BLOCK_SIZE) {
+    PUT(HDRP(bp), PACK(asize, 1) | prev_alloc);
     bp = NEXT_BLKP(bp);
-    PUT(HDRP(bp), PACK(csize-asize, 0));
+    PUT(HDRP(bp), PACK(csize-asize, 0) | PREV_ALLOC);
     PUT(FTRP(bp), PACK(csize-asize, 0));
     coalesce(bp);
   }
   else {
-    PUT(HDRP(bp), PACK(csize, 1));
-    PUT(FTRP(bp), PACK(csize, 1));
-    remove_from_free_list(bp);
+    PUT(HDRP(bp), PACK(csize, 1) | prev_alloc);
+    SET_PREV_ALLOC(HDRP(NEXT_BLKP(bp)));
   }
 }
 
 /*
- * insert_in_free_list: adds given block to start of free list
+ * insert_in_free_list: adds given block to start of the free list for its size class
  */
 
 static void insert_in_free_list(void *bp){
-  SET_NEXT_PTR(bp, free_list_start); //make bp's next pointer  point to the old first element in the list
-  SET_PREV_PTR(free_list_start, bp); //make the old first element's previous pointer point to bp
+  int class;
+  char *start;
+
+#if FREE_LIST_POLICY == BEST_FIT_TREE
+  if (GET_SIZE(HDRP(bp)) >= TREE_MIN) {
+    tree_insert(bp);
+    return;
+  }
+#endif
+  class = size_class(GET_SIZE(HDRP(bp)));
+  start = arena->free_lists[class];
+
+  SET_NEXT_PTR(bp, start); //make bp's next pointer  point to the old first element in the list
+  if (start)
+    SET_PREV_PTR(start, bp); //make the old first element's previous pointer point to bp
   SET_PREV_PTR(bp, NULL); //make bp's previous pointer point to null
-  free_list_start = bp; //make bp the start of the list
+  arena->free_lists[class] = bp; //make bp the start of the list
+#if FREE_LIST_POLICY == TLSF_INDEX
+  arena->fl_bitmap |= 1UL << (class / SL_COUNT);
+  arena->sl_bitmap[class / SL_COUNT] |= 1U << (class % SL_COUNT);
+#endif
 }
 
 /*
- * remove from_free list: Removes given block from free list.
+ * remove from_free list: Removes given block from its free list.  The block's header must
+ * still hold the size it was inserted with, since that picks the list.
  */
 
 static void remove_from_free_list(void *bp){
+  void* prev_pointer;
+  void* next_pointer;
+
+#if FREE_LIST_POLICY == BEST_FIT_TREE
+  if (GET_SIZE(HDRP(bp)) >= TREE_MIN) {
+    tree_remove(bp);
+    return;
+  }
+#endif
   //Get bp's previous and next pointers
-  void* prev_pointer = GET_PREV_PTR(bp);
-  void* next_pointer = GET_NEXT_PTR(bp);
+  prev_pointer = GET_PREV_PTR(bp);
+  next_pointer = GET_NEXT_PTR(bp);
 
   //If bp is not at the start of the list, have the previous pointer point to the next pointer 
   if (prev_pointer)
     SET_NEXT_PTR(prev_pointer, next_pointer);
 
   //If bp is at the start of the list, have the start now be the next pointer
-  else
-    free_list_start = next_pointer;
+  else {
+    int class = size_class(GET_SIZE(HDRP(bp)));
+    arena->free_lists[class] = next_pointer;
+#if FREE_LIST_POLICY == TLSF_INDEX
+    //If the list is now empty, clear its bit (and its level's bit if that was the last list)
+    if (next_pointer == NULL) {
+      arena->sl_bitmap[class / SL_COUNT] &= ~(1U << (class % SL_COUNT));
+      if (arena->sl_bitmap[class / SL_COUNT] == 0)
+        arena->fl_bitmap &= ~(1UL << (class / SL_COUNT));
+    }
+#endif
+  }
 
   //Make next's previous pointer point to bp's old previous pointer
-  SET_PREV_PTR(next_pointer, prev_pointer);
+  if (next_pointer)
+    SET_PREV_PTR(next_pointer, prev_pointer);
 }
 
+#if FREE_LIST_POLICY == BEST_FIT_TREE
 /*
- * mm_init: Initializes the malloc package by creating an empty heap, adding the necessary
- * headers/footers, and extending the empty heap the necessary amount to accomdate these
- * headers/footers.   
+ * tree_rotate_left / tree_rotate_right: Standard red-black rotations around bp, updating
+ * tree_root if bp was the root.
  */
-//*****Begin Textbook Code*****
-int mm_init(void)
-{
-  /* Create the initial empty heap */
-  if ((heap_listp = mem_sbrk(8*WSIZE)) == (void *)-1)
-    return -1;
-    
-  PUT(heap_listp, 0); /* Alignment padding */
-  PUT(heap_listp + (1*WSIZE), PACK(DSIZE, 1)); /* Prologue header */
-  PUT(heap_listp + (2*WSIZE), PACK(DSIZE, 1)); /* Prologue footer */
-  PUT(heap_listp + (3*WSIZE), PACK(0, 1)); /* Epilogue header */
-  free_list_start = heap_listp + 2 * WSIZE;
-  heap_listp += 2*WSIZE;
-    
-  /* Extend the empty heap with a free block of CHUNKSIZE bytes */
-  if (extend_heap(CHUNKSIZE/WSIZE) == NULL)
-    return -1;
-  return 0;
+static void tree_rotate_left(char *bp){
+  char *rp = TREE_RIGHT(bp);
+
+  TREE_RIGHT(bp) = TREE_LEFT(rp);
+  if (TREE_LEFT(rp))
+    TREE_PARENT(TREE_LEFT(rp)) = bp;
+  TREE_PARENT(rp) = TREE_PARENT(bp);
+  if (TREE_PARENT(bp) == NULL)
+    arena->tree_root = rp;
+  else if (bp == TREE_LEFT(TREE_PARENT(bp)))
+    TREE_LEFT(TREE_PARENT(bp)) = rp;
+  else
+    TREE_RIGHT(TREE_PARENT(bp)) = rp;
+  TREE_LEFT(rp) = bp;
+  TREE_PARENT(bp) = rp;
+}
+
+static void tree_rotate_right(char *bp){
+  char *lp = TREE_LEFT(bp);
+
+  TREE_LEFT(bp) = TREE_RIGHT(lp);
+  if (TREE_RIGHT(lp))
+    TREE_PARENT(TREE_RIGHT(lp)) = bp;
+  TREE_PARENT(lp) = TREE_PARENT(bp);
+  if (TREE_PARENT(bp) == NULL)
+    arena->tree_root = lp;
+  else if (bp == TREE_RIGHT(TREE_PARENT(bp)))
+    TREE_RIGHT(TREE_PARENT(bp)) = lp;
+  else
+    TREE_LEFT(TREE_PARENT(bp)) = lp;
+  TREE_RIGHT(lp) = bp;
+  TREE_PARENT(bp) = lp;
 }
+
 /*
- * mm_malloc: Allocates a block by incrementing the brk pointer while preserving alignment.
- * After adjusting block size to include necessary headers/footers/match alignment, searches
- * the free list for a fit.  If no fit is found, the heap is extended and the block is
- * allocated to the end of the heap.
+ * tree_insert: Adds free block bp to the tree as a red leaf, then recolors and rotates
+ * until no red node has a red parent.
  */
-void *mm_malloc(size_t size)
-{
-  size_t asize;      /* Adjusted block size */
-  size_t extendsize; /* Amount to extend heap if no fit */
-  void *bp;
-    
-  /* Ignore spurious requests. */
-  if (size == 0)
-    return (NULL);
-    
-  /* Adjust block size to include overhead and alignment reqs. */
-  if (size <= DSIZE)
-    asize = 2 * DSIZE;
-  else
-    asize = DSIZE * ((size + DSIZE + (DSIZE - 1)) / DSIZE);
-    
-  /* Search the free list for a fit. */
-  if ((bp = find_fit(asize)) != NULL) {
-    place(bp, asize);
-    return (bp);
-  }
-    
-  /* No fit found.  Get more memory and place the block. */
-  extendsize = MAX(asize, CHUNKSIZE);
-  if ((bp = extend_heap(extendsize / WSIZE)) == NULL)
-    return (NULL);
-  place(bp, asize);
+static void tree_insert(char *bp){
+  char *parent = NULL;
+  char *node = arena->tree_root;
+  char *grandparent, *uncle;
 
-  //if (CHECK && CHECK_MALLOC)
-  //mm_check('a', bp, checksize);
+  while (node) {
+    parent = node;
+    node = TREE_LESS(bp, node) ? TREE_LEFT(node) : TREE_RIGHT(node);
+  }
+  TREE_PARENT(bp) = parent;
+  TREE_LEFT(bp) = NULL;
+  TREE_RIGHT(bp) = NULL;
+  TREE_COLOR(bp) = RED;
+  if (parent == NULL)
+    arena->tree_root = bp;
+  else if (TREE_LESS(bp, parent))
+    TREE_LEFT(parent) = bp;
+  else
+    TREE_RIGHT(parent) = bp;
 
-  return (bp);
+  while (IS_RED(parent = TREE_PARENT(bp))) {
+    grandparent = TREE_PARENT(parent); //a red node is never the root
+    if (parent == TREE_LEFT(grandparent)) {
+      uncle = TREE_RIGHT(grandparent);
+      if (IS_RED(uncle)) {
+        TREE_COLOR(parent) = BLACK;
+        TREE_COLOR(uncle) = BLACK;
+        TREE_COLOR(grandparent) = RED;
+        bp = grandparent;
+      }
+      else {
+        if (bp == TREE_RIGHT(parent)) {
+          bp = parent;
+          tree_rotate_left(bp);
+          parent = TREE_PARENT(bp);
+        }
+        TREE_COLOR(parent) = BLACK;
+        TREE_COLOR(grandparent) = RED;
+        tree_rotate_right(grandparent);
+      }
+    }
+    else {
+      uncle = TREE_LEFT(grandparent);
+      if (IS_RED(uncle)) {
+        TREE_COLOR(parent) = BLACK;
+        TREE_COLOR(uncle) = BLACK;
+        TREE_COLOR(grandparent) = RED;
+        bp = grandparent;
+      }
+      else {
+        if (bp == TREE_LEFT(parent)) {
+          bp = parent;
+          tree_rotate_right(bp);
+          parent = TREE_PARENT(bp);
+        }
+        TREE_COLOR(parent) = BLACK;
+        TREE_COLOR(grandparent) = RED;
+        tree_rotate_left(grandparent);
+      }
+    }
+  }
+  TREE_COLOR(arena->tree_root) = BLACK;
 }
+
 /*
- * mm_free: Frees the block pointed to by bp.  If bp is null, the function does nothing.
- * If bp is not null, the function adjuts the block's header and footer to mark it as free
- * and coalesces the block.
+ * tree_transplant: Puts subtree qp (possibly NULL) where bp was in bp's parent.
  */
-
-void mm_free(void *bp)
-{
-  size_t size = GET_SIZE(HDRP(bp));
-  if (bp == NULL)
-    return;
-    
-  PUT(HDRP(bp), PACK(size, 0));
-  PUT(FTRP(bp), PACK(size, 0));
-  coalesce(bp);
+static void tree_transplant(char *bp, char *qp){
+  if (TREE_PARENT(bp) == NULL)
+    arena->tree_root = qp;
+  else if (bp == TREE_LEFT(TREE_PARENT(bp)))
+    TREE_LEFT(TREE_PARENT(bp)) = qp;
+  else
+    TREE_RIGHT(TREE_PARENT(bp)) = qp;
+  if (qp)
+    TREE_PARENT(qp) = TREE_PARENT(bp);
 }
-//*****End Textbook Code*****
 
 /*
- * mm_realloc: Returns a pointer to an unallocated region of at least size bytes.
- * If the size is less than 0, the function returns NULL
- * If the size is equal to 0, the function acts as mm_free
- * If the size is greater than 0, the size of the memory block pointed to by bp is changed 
- * to size (plus space for header and footer).  If the new size is less than the old size,
- * the address of the block (and bp) is unchanged.  Otherwise, if the next block is free,
- * the blocks are combined and the next block is removed from the free list.  Else, the
- * function uses mm_malloc to allocate a sufficiently sized block and updates bp
- * accordingly.
+ * tree_remove: Unlinks bp from the tree.  If a black node was taken out, the subtree that
+ * replaced it (x, which may be empty, below parent) is one black short and gets fixed up.
  */
-void *mm_realloc(void *bp, size_t size)
-{
-  if((int)size < 0)
-    return NULL;
-  else if((int)size == 0){
-    mm_free(bp);
-    return NULL;
+static void tree_remove(char *bp){
+  char *moved = bp;
+  unsigned int moved_color = TREE_COLOR(bp);
+  char *x, *parent, *sibling;
+
+  if (TREE_LEFT(bp) == NULL) {
+    x = TREE_RIGHT(bp);
+    parent = TREE_PARENT(bp);
+    tree_transplant(bp, x);
   }
-  else if(size > 0){
-    size_t oldsize = GET_SIZE(HDRP(bp));
-    size_t newsize = size + 2 * WSIZE; // 2 words for header and footer
-    /*if newsize is less than oldsize then we just return bp */
-    if(newsize <= oldsize){
-      return bp;
+  else if (TREE_RIGHT(bp) == NULL) {
+    x = TREE_LEFT(bp);
+    parent = TREE_PARENT(bp);
+    tree_transplant(bp, x);
+  }
+  else {
+    //Replace bp with its successor, the leftmost node of its right subtree
+    moved = TREE_RIGHT(bp);
+    while (TREE_LEFT(moved))
+      moved = TREE_LEFT(moved);
+    moved_color = TREE_COLOR(moved);
+    x = TREE_RIGHT(moved);
+    if (TREE_PARENT(moved) == bp)
+      parent = moved;
+    else {
+      parent = TREE_PARENT(moved);
+      tree_transplant(moved, x);
+      TREE_RIGHT(moved) = TREE_RIGHT(bp);
+      TREE_PARENT(TREE_RIGHT(moved)) = moved;
+    }
+    tree_transplant(bp, moved);
+    TREE_LEFT(moved) = TREE_LEFT(bp);
+    TREE_PARENT(TREE_LEFT(moved)) = moved;
+    TREE_COLOR(moved) = TREE_COLOR(bp);
+  }
+  if (moved_color == RED)
+    return;
+
+  while (x != arena->tree_root && !IS_RED(x)) {
+    if (x == TREE_LEFT(parent)) {
+      sibling = TREE_RIGHT(parent);
+      if (IS_RED(sibling)) {
+        TREE_COLOR(sibling) = BLACK;
+        TREE_COLOR(parent) = RED;
+        tree_rotate_left(parent);
+        sibling = TREE_RIGHT(parent);
+      }
+      if (!IS_RED(TREE_LEFT(sibling)) && !IS_RED(TREE_RIGHT(sibling))) {
+        TREE_COLOR(sibling) = RED;
+        x = parent;
+        parent = TREE_PARENT(x);
+      }
+      else {
+        if (!IS_RED(TREE_RIGHT(sibling))) {
+          TREE_COLOR(TREE_LEFT(sibling)) = BLACK;
+          TREE_COLOR(sibling) = RED;
+          tree_rotate_right(sibling);
+          sibling = TREE_RIGHT(parent);
+        }
+        TREE_COLOR(sibling) = TREE_COLOR(parent);
+        TREE_COLOR(parent) = BLACK;
+        TREE_COLOR(TREE_RIGHT(sibling)) = BLACK;
+        tree_rotate_left(parent);
+        x = arena->tree_root;
+      }
     }
-    /*if newsize is greater than oldsize */
     else {
-      size_t next_alloc = GET_ALLOC(HDRP(NEXT_BLKP(bp)));
-      size_t csize;
-      /* next block is free and the size of the two blocks is greater than or equal the new size  */
-      /* then we only need to combine both the blocks  */
-      if(!next_alloc && ((csize = oldsize + GET_SIZE(  HDRP(NEXT_BLKP(bp))  ))) >= newsize){
-	remove_from_free_list(NEXT_BLKP(bp));
-	PUT(HDRP(bp), PACK(csize, 1));
-	PUT(FTRP(bp), PACK(csize, 1));
-	return bp;
+      sibling = TREE_LEFT(parent);
+      if (IS_RED(sibling)) {
+        TREE_COLOR(sibling) = BLACK;
+        TREE_COLOR(parent) = RED;
+        tree_rotate_right(parent);
+        sibling = TREE_LEFT(parent);
+      }
+      if (!IS_RED(TREE_LEFT(sibling)) && !IS_RED(TREE_RIGHT(sibling))) {
+        TREE_COLOR(sibling) = RED;
+        x = parent;
+        parent = TREE_PARENT(x);
       }
       else {
-	void *new_ptr = mm_malloc(newsize);
-	place(new_ptr, newsize);
-	memcpy(new_ptr, bp, newsize);
-	mm_free(bp);
-	return new_ptr;
+        if (!IS_RED(TREE_LEFT(sibling))) {
+          TREE_COLOR(TREE_RIGHT(sibling)) = BLACK;
+          TREE_COLOR(sibling) = RED;
+          tree_rotate_left(sibling);
+          sibling = TREE_LEFT(parent);
+        }
+        TREE_COLOR(sibling) = TREE_COLOR(parent);
+        TREE_COLOR(parent) = BLACK;
+        TREE_COLOR(TREE_LEFT(sibling)) = BLACK;
+        tree_rotate_right(parent);
+        x = arena->tree_root;
       }
     }
   }
+  if (x)
+    TREE_COLOR(x) = BLACK;
+}
+
+/*
+ * tree_search: Returns the smallest tree block of at least asize bytes, the lowest addressed
+ * one among equal sizes, or null if no tree block is big enough.
+ */
+static char *tree_search(size_t asize){
+  char *node = arena->tree_root;
+  char *fit = NULL;
+
+  while (node) {
+    if (GET_SIZE(HDRP(node)) >= asize) {
+      fit = node;
+      node = TREE_LEFT(node);
+    }
+    else
+      node = TREE_RIGHT(node);
+  }
+  return fit;
+}
+#endif
+
+#if SLAB_MAX > 0
+/*
+ * is_slab: Returns true if bp lies in a page that is currently a run.  The acquire load pairs
+ * with the release store in mark_run, so the map read is filled in up to its size.
+ */
+static int is_slab(void *bp){
+  run_map_t *map = __atomic_load_n(&arena->run_map, __ATOMIC_ACQUIRE);
+  size_t page = PAGE_INDEX(bp);
+
+  return map != NULL && page < map->pages &&
+    (__atomic_load_n(&map->bits[page / 8], __ATOMIC_RELAXED) >> (page % 8)) & 1;
+}
+
+/*
+ * mark_run: Sets or clears the run_map bit of the page starting at run.  Setting a bit past
+ * the end of the map first replaces the map with one of twice its size (or enough to cover
+ * the page), rounded up to whole pages, from mem_map.  A page of map covers 128 MB of heap.
+ * In THREADED builds the old map stays mapped, linked from the new one, since another thread
+ * may still be reading it without the lock; each map is at least twice the size of the last,
+ * so the old ones add up to less than the current one.  Returns -1 if the mapping fails.
+ */
+static int mark_run(run_t *run, int set){
+  run_map_t *map = arena->run_map, *old = map;
+  size_t page = PAGE_INDEX(run);
+  unsigned char *byte;
+
+  if (map == NULL || page >= map->pages) {
+    size_t len;
+
+    if (!set)
+      return 0;
+    len = RUN_MAP_LENGTH(MAX(old ? 2 * old->pages : 0, page + 8));
+    len = (len + mem_pagesize() - 1) & ~(mem_pagesize() - 1);
+    if ((map = mem_map(len, mem_pagesize())) == NULL)
+      return -1;
+    map->pages = (len - sizeof(run_map_t)) * 8;
+    if (old)
+      memcpy(map->bits, old->bits, old->pages / 8);
+#if THREADED
+    map->prev = old;
+#endif
+    __atomic_store_n(&arena->run_map, map, __ATOMIC_RELEASE);
+#if !THREADED
+    if (old)
+      mem_unmap(old, RUN_MAP_LENGTH(old->pages));
+#endif
+  }
+  byte = &map->bits[page / 8];
+  if (set)
+    __atomic_store_n(byte, *byte | 1 << (page % 8), __ATOMIC_RELAXED);
+  else
+    __atomic_store_n(byte, *byte & ~(1 << (page % 8)), __ATOMIC_RELAXED);
+  return 0;
+}
+
+/*
+ * run_link / run_unlink: add the run to / remove it from the partial_runs list of its class.
+ */
+static void run_link(run_t *run){
+  int class = run->objsize / ALIGNMENT - 1;
+
+  run->prev = NULL;
+  run->next = arena->partial_runs[class];
+  if (run->next)
+    run->next->prev = run;
+  arena->partial_runs[class] = run;
+}
+
+static void run_unlink(run_t *run){
+  if (run->prev)
+    run->prev->next = run->next;
   else
+    arena->partial_runs[run->objsize / ALIGNMENT - 1] = run->next;
+  if (run->next)
+    run->next->prev = run->prev;
+}
+
+/*
+ * run_create: Places a RUN_SIZE block with a page-aligned payload (see aligned_block) and sets
+ * it up as an empty run for objects of objsize bytes.
+ */
+static run_t *run_create(size_t objsize){
+  char *runp;
+  run_t *run;
+
+  if ((runp = aligned_block(RUN_SIZE, RUN_SIZE, (size_t)arena->heap_start)) == NULL)
     return NULL;
+
+  run = (run_t *)runp;
+  if (mark_run(run, 1) < 0) {
+    free_block(runp);
+    return NULL;
+  }
+  run->free = NULL;
+  run->unused = runp + RUN_HDR_SIZE;
+  run->objsize = objsize;
+  run->nfree = RUN_CAPACITY(run);
+  run_link(run);
+  return run;
+}
+
+/*
+ * slab_alloc: Hands out an object of the size class of size from the first partial run of
+ * that class, creating a run if there is none.  A run that runs out of objects leaves the
+ * partial list.
+ */
+static void *slab_alloc(size_t size){
+  int class = (size - 1) / ALIGNMENT;
+  run_t *run = arena->partial_runs[class];
+  char *bp;
+
+  if (run == NULL && (run = run_create((class + 1) * ALIGNMENT)) == NULL)
+    return NULL;
+  if (run->free) {
+    bp = run->free;
+    run->free = *(char **)bp;
+  }
+  else {
+    bp = run->unused;
+    run->unused += run->objsize;
+  }
+  if (--run->nfree == 0)
+    run_unlink(run);
+  return bp;
+}
+
+/*
+ * slab_free: Returns an object to its run.  A full run goes back on the partial list; a run
+ * that becomes empty is handed back to the boundary-tag heap unless it is the only partial
+ * run of its class, which is kept to avoid creating and releasing a run on every call.
+ */
+static void slab_free(void *bp){
+  run_t *run = RUN_OF(bp);
+
+  *(char **)bp = run->free;
+  run->free = bp;
+  if (run->nfree++ == 0)
+    run_link(run);
+  else if (run->nfree == RUN_CAPACITY(run) && (run->prev || run->next)) {
+    run_unlink(run);
+    mark_run(run, 0);
+    free_block(run);
+  }
+}
+
+/*
+ * slab_trim: Hands every empty run of the current arena back to the boundary-tag heap,
+ * including the one slab_free keeps for each class.
+ */
+static void slab_trim(void){
+  run_t *run, *next;
+
+  for (int class = 0; class < SLAB_CLASSES; class++) {
+    for (run = arena->partial_runs[class]; run != NULL; run = next) {
+      next = run->next;
+      if (run->nfree == RUN_CAPACITY(run)) {
+        run_unlink(run);
+        mark_run(run, 0);
+        free_block(run);
+      }
+    }
+  }
+}
+
+/*
+ * run_maps_release: Unmaps the current arena's run map, and in THREADED builds the maps it
+ * replaced, when arena_init starts the heap over.
+ */
+static void run_maps_release(void){
+  run_map_t *map, *prev;
+
+  for (map = arena->run_map; map != NULL; map = prev) {
+    prev = map->prev;
+    mem_unmap(map, RUN_MAP_LENGTH(map->pages));
+  }
+  arena->run_map = NULL;
+}
+#endif
+
+/*
+ * arena_sbrk: Grows the heap of the current arena by incr bytes and returns the old end of
+ * the heap, or (void *)-1 if there is no room.  main_arena grows through mem_sbrk (up to
+ * LINK_RANGE with COMPRESSED_LINKS), the others within their reservation.  Growing right after
+ * a trim raises trim_threshold.
+ */
+static void *arena_sbrk(size_t incr){
+  char *old_brk = arena->brk;
+
+  if (arena == &main_arena) {
+#if COMPRESSED_LINKS
+    if ((uint64_t)mem_heapsize() + incr > LINK_RANGE)
+      return (void *)-1;
+#endif
+    if ((old_brk = mem_sbrk(incr)) == (void *)-1)
+      return old_brk;
+  }
+  else if (incr > (size_t)(arena->end - arena->brk))
+    return (void *)-1;
+  __atomic_store_n(&arena->brk, old_brk + incr, __ATOMIC_RELAXED);
+  if (arena->trimmed) {
+    size_t threshold = __atomic_load_n(&trim_threshold, __ATOMIC_RELAXED);
+
+    if (threshold < TRIM_THRESHOLD_MAX)
+      __atomic_store_n(&trim_threshold, 2 * threshold, __ATOMIC_RELAXED);
+    arena->trimmed = false;
+  }
+  return old_brk;
+}
+
+/*
+ * arena_shrink: Takes decr bytes off the end of the current arena's heap and gives their
+ * pages back.
+ */
+static void arena_shrink(size_t decr){
+  if (arena == &main_arena)
+    mem_sbrk(-(intptr_t)decr);
+  else
+    mem_discard(arena->brk - decr, decr);
+  __atomic_store_n(&arena->brk, arena->brk - decr, __ATOMIC_RELAXED);
+}
+
+/*
+ * arena_of: Returns the arena that block bp was allocated from, or null if bp is a large
+ * block with a mapping of its own.  Callers do not hold main_arena's lock, so its brk may be
+ * moving; it is read atomically, and any value read lies above every block allocated from
+ * main_arena that the caller can hold, since trimming only takes free space off the top.
+ */
+static arena_t *arena_of(void *bp){
+  if ((char *)bp >= main_arena.heap_start &&
+      (char *)bp < __atomic_load_n(&main_arena.brk, __ATOMIC_RELAXED))
+    return &main_arena;
+#if THREADED
+  arena_t *a = (arena_t *)((size_t)bp & ~(size_t)(ARENA_SIZE - 1));
+
+  for (int i = 1; i < NUM_ARENAS; i++)
+    if (__atomic_load_n(&arenas[i], __ATOMIC_ACQUIRE) == a)
+      return a;
+#endif
+  return NULL;
+}
+
+#if THREADED
+
+/*
+ * get_thread_arena: Returns the arena the calling thread allocates from, assigning the next
+ * one round robin (and creating it if need be) on the thread's first call.  Falls back to
+ * main_arena if a new arena cannot be set up.  A new arena is published in arenas with a
+ * release store once its lock and heap are set up, since arena_of and mm_trim read arenas
+ * without arenas_lock.
+ */
+static arena_t *get_thread_arena(void){
+  arena_t *a;
+  int i;
+
+  if (thread_arena != NULL)
+    return thread_arena;
+  pthread_mutex_lock(&arenas_lock);
+  i = next_arena++ % NUM_ARENAS;
+  if ((a = arenas[i]) == NULL) {
+    if ((a = mem_map(ARENA_SIZE, ARENA_SIZE)) != NULL) {
+      pthread_mutex_init(&a->lock, NULL);
+      a->brk = ARENA_HEAP(a);
+      a->end = (char *)a + ARENA_SIZE;
+      arena = a;
+      if (arena_init() == 0)
+        __atomic_store_n(&arenas[i], a, __ATOMIC_RELEASE);
+      else {
+        mem_unmap(a, ARENA_SIZE);
+        a = NULL;
+      }
+    }
+    if (a == NULL)
+      a = &main_arena;
+  }
+  pthread_mutex_unlock(&arenas_lock);
+  return thread_arena = a;
+}
+#endif
+
+/*
+ * map_block: Returns a large block of size bytes in a mapping of its own, with its payload
+ * aligned to align bytes (a power of two), or null.  An alignment above ALIGNMENT puts the
+ * block align bytes into a mapping that is itself aligned to at least align.
+ */
+static void *map_block(size_t size, size_t align){
+  size_t lead = (align > ALIGNMENT) ? align - MAP_HDR_SIZE : 0;
+  size_t len = MAP_LENGTH(size + lead);
+  char *p;
+
+  if (size + lead >= MAP_MAX || (p = mem_map(len, MAX(align, mem_pagesize()))) == NULL)
+    return NULL;
+  p += lead;
+  PUT(p + MAP_HDR_SIZE - DSIZE, lead);
+  PUT(p + MAP_HDR_SIZE - WSIZE, PACK(len, 1));
+  return p + MAP_HDR_SIZE;
+}
+
+/*
+ * unmap_block: Releases the mapping of large block bp, raising mmap_threshold to its size (and
+ * trim_threshold to twice that) if that is bigger.
+ */
+static void unmap_block(void *bp){
+  size_t len = GET_SIZE(HDRP(bp));
+
+  if (len > __atomic_load_n(&mmap_threshold, __ATOMIC_RELAXED) && len <= MMAP_THRESHOLD_MAX) {
+    __atomic_store_n(&mmap_threshold, len, __ATOMIC_RELAXED);
+    __atomic_store_n(&trim_threshold, 2 * len, __ATOMIC_RELAXED);
+  }
+  mem_unmap((char *)bp - MAP_HDR_SIZE - MAP_LEAD(bp), len);
+}
+
+/*
+ * remap_block: Resizes the mapping of large block bp to hold size bytes and returns the
+ * block's new address, or null (leaving bp alone) if the mapping cannot be resized.  The lead
+ * moves along with the block.
+ */
+static void *remap_block(void *bp, size_t size){
+  size_t lead = MAP_LEAD(bp);
+  size_t len = MAP_LENGTH(size + lead);
+  size_t oldlen = GET_SIZE(HDRP(bp));
+  char *p;
+
+  if (size + lead >= MAP_MAX)
+    return NULL;
+  if (len == oldlen)
+    return bp;
+  if ((p = mem_remap((char *)bp - MAP_HDR_SIZE - lead, oldlen, len)) == NULL)
+    return NULL;
+  p += lead;
+  PUT(p + MAP_HDR_SIZE - WSIZE, PACK(len, 1));
+  return p + MAP_HDR_SIZE;
+}
+
+/*
+ * heap_trim: Shrinks the current arena's heap so that at most pad bytes of the free block at its
+ * top remain, releasing whole pages only.  Returns the number of bytes released.
+ */
+static size_t heap_trim(size_t pad){
+  char *bp, *brk = arena->brk;
+  size_t size, release, pagesize = mem_pagesize();
+
+  if (GET_PREV_ALLOC(brk - WSIZE))    /* the block below the epilogue is allocated */
+    return 0;
+  size = GET_SIZE(brk - DSIZE);
+  bp = brk - size;
+  if (size <= pad)
+    return 0;
+  release = (size - pad) & ~(pagesize - 1);
+  if (release > 0 && release < size && size - release < MIN_BLOCK_SIZE)
+    release -= pagesize;
+  if (release == 0)
+    return 0;
+
+  remove_from_free_list(bp);
+  if (release == size)
+    PUT(HDRP(bp), PACK(0, 1) | GET_PREV_ALLOC(HDRP(bp)));   /* the block's header becomes the epilogue */
+  else {
+    size -= release;
+    PUT(HDRP(bp), PACK(size, 0) | GET_PREV_ALLOC(HDRP(bp)));
+    PUT(FTRP(bp), PACK(size, 0));
+    PUT(HDRP(NEXT_BLKP(bp)), PACK(0, 1));
+    insert_in_free_list(bp);
+  }
+  arena_shrink(release);
+  arena->trimmed = true;
+  return release;
+}
+
+/* Bytes at the start of a free block that discarding keeps: its list links or tree node */
+#define DISCARD_KEEP (4 * sizeof(char *))
+
+/*
+ * discard_block: Gives back the whole pages inside free block bp, past its links and before
+ * its footer, and returns how many bytes that is.
+ */
+static size_t discard_block(char *bp){
+  size_t page = mem_pagesize();
+  char *lo = (char *)(((uintptr_t)bp + DISCARD_KEEP + page - 1) & ~(page - 1));
+  char *hi = (char *)(((uintptr_t)bp + GET_SIZE(HDRP(bp)) - DSIZE) & ~(page - 1));
+
+  if (lo >= hi)
+    return 0;
+  mem_discard(lo, hi - lo);
+  return hi - lo;
+}
+
+#if FREE_LIST_POLICY == BEST_FIT_TREE
+/*
+ * tree_discard: discard_block for every block of at least min bytes in the subtree at node.
+ */
+static size_t tree_discard(char *node, size_t min){
+  size_t total = 0;
+
+  for (; node != NULL; node = TREE_RIGHT(node)) {
+    if (GET_SIZE(HDRP(node)) < min)
+      continue;
+    total += tree_discard(TREE_LEFT(node), min) + discard_block(node);
+  }
+  return total;
+}
+#endif
+
+/*
+ * heap_discard: Gives back the whole pages inside every free block of the current arena,
+ * keeping the free list links at the start of each block and the footer at its end.  Only
+ * the free lists (or tree) that can hold a block big enough to contain a page are walked.
+ * Returns the number of bytes released.
+ */
+static size_t heap_discard(void){
+  size_t size, total = 0, min = DISCARD_KEEP + DSIZE + mem_pagesize();
+  char *bp;
+
+#if FREE_LIST_POLICY == BEST_FIT_TREE
+  if (min >= TREE_MIN)
+    return tree_discard(arena->tree_root, min);
+#endif
+  for (int class = size_class(min); class < NUM_CLASSES; class++)
+    for (bp = arena->free_lists[class]; bp != NULL; bp = GET_NEXT_PTR(bp))
+      if ((size = GET_SIZE(HDRP(bp))) >= min)
+        total += discard_block(bp);
+#if FREE_LIST_POLICY == BEST_FIT_TREE
+  total += tree_discard(arena->tree_root, min);
+#endif
+  return total;
+}
+
+/*
+ * mm_trim: Gives memory back to the system, in every arena: the top of the heap down to pad
+ * free bytes, and the whole pages inside free blocks, once the empty slab runs are released,
+ * the fast bins consolidated and the realloc reserves freed.  In THREADED builds the calling
+ * thread's cache is flushed first and the blocks other threads freed to each arena are freed
+ * for real.  Returns 1 if any memory was released and 0 otherwise.
+ */
+int mm_trim(size_t pad)
+{
+  size_t released = 0;
+
+#if THREADED
+  tcache_release(NULL);
+#endif
+  for (int i = 0; i < NUM_ARENAS; i++) {
+#if THREADED
+    if ((arena = __atomic_load_n(&arenas[i], __ATOMIC_ACQUIRE)) == NULL)
+      continue;
+#endif
+    LOCK(arena);
+#if THREADED
+    remote_drain();
+#endif
+#if SLAB_MAX > 0
+    slab_trim();
+#endif
+#if FASTBIN_MAX > 0
+    fast_consolidate();
+#endif
+    reserve_reclaim();
+    released += heap_trim(pad);
+    released += heap_discard();
+    UNLOCK(arena);
+  }
+  return released > 0;
+}
+
+/*
+ * mm_init: Initializes the malloc package by setting up an empty heap in main_arena.  Extra
+ * arenas left from before are emptied rather than unmapped, so threads keep their arenas, and
+ * the adaptive thresholds keep what they learned.
+ */
+int mm_init(void)
+{
+  arena = &main_arena;
+  if (arena_init() < 0)
+    return -1;
+#if THREADED
+  for (int i = 1; i < NUM_ARENAS; i++) {
+    if ((arena = arenas[i]) != NULL) {
+      arena->brk = ARENA_HEAP(arena);
+      if (arena_init() < 0)
+        return -1;
+    }
+  }
+  memset(tcache.head, 0, sizeof(tcache.head));   /* blocks cached from the old heap are gone */
+  memset(tcache.count, 0, sizeof(tcache.count));
+#endif
+  return 0;
+}
+
+/*
+ * arena_init: Creates an empty heap in the current arena by adding the necessary
+ * headers/footers, and extending the empty heap the necessary amount to accomdate these
+ * headers/footers.   
+ */
+//*****Begin Textbook Code*****
+static int arena_init(void)
+{
+  char *heap_listp;
+
+#if SLAB_MAX > 0
+  run_maps_release();   /* before the heap grows, so the old map is not counted */
+#endif
+  /* Create the initial empty heap */
+  if ((heap_listp = arena_sbrk(4*WSIZE)) == (void *)-1)
+    return -1;
+  arena->heap_start = heap_listp;
+    
+  PUT(heap_listp, 0); /* Alignment padding */
+  PUT(heap_listp + (1*WSIZE), PACK(DSIZE, 1)); /* Prologue header */
+  PUT(heap_listp + (2*WSIZE), PACK(DSIZE, 1)); /* Prologue footer */
+  PUT(heap_listp + (3*WSIZE), PACK(0, 1) | PREV_ALLOC); /* Epilogue header */
+  for (int i = 0; i < NUM_CLASSES; i++)
+    arena->free_lists[i] = NULL;
+  arena->reserved = 0;
+  arena->chunk = CHUNKSIZE;
+  arena->last_grow = CHUNKSIZE;
+  arena->allocated = 0;
+#if FASTBIN_MAX > 0
+  for (int i = 0; i < FASTBINS; i++) {
+    arena->fastbins[i] = NULL;
+    arena->fast_count[i] = 0;
+  }
+  arena->fast_blocks = 0;
+#endif
+#if FREE_LIST_POLICY == BEST_FIT_TREE
+  arena->tree_root = NULL;
+#endif
+#if FREE_LIST_POLICY == TLSF_INDEX
+  arena->fl_bitmap = 0;
+  for (int i = 0; i < FL_COUNT; i++)
+    arena->sl_bitmap[i] = 0;
+#endif
+#if SLAB_MAX > 0
+  for (int i = 0; i < SLAB_CLASSES; i++)
+    arena->partial_runs[i] = NULL;
+#endif
+#if THREADED
+  arena->remote_frees = NULL;
+  arena->remote_count = 0;
+#endif
+  heap_listp += 2*WSIZE;
+    
+  /* Extend the empty heap with a free block of CHUNKSIZE bytes */
+  if (extend_heap(CHUNKSIZE/WSIZE) == NULL)
+    return -1;
+  return 0;
+}
+//*****End Textbook Code*****
+
+#if THREADED
+/*
+ * chunk_size: Returns the size of the slab object or block mm_malloc hands out for size bytes.
+ */
+static size_t chunk_size(size_t size){
+#if SLAB_MAX > 0
+  if (size <= SLAB_MAX)
+    return ALIGN(size);
+#endif
+  return ADJUSTED_SIZE(size);
+}
+
+/*
+ * chunk_size_of: Returns the chunk size of the allocated slab object or block bp, which must
+ * belong to the current arena, or 0 for a block mm_malloc would never hand out as it is.  That
+ * is a block mm_realloc cut down to a slab size, which has less room than a slab object of its
+ * size, or a block with a realloc reserve, whose slack has to be freed by heap_free.
+ */
+static size_t chunk_size_of(void *bp){
+#if SLAB_MAX > 0
+  if (is_slab(bp))
+    return RUN_OF(bp)->objsize;
+#endif
+  return block_chunk_size(bp);
+}
+
+/*
+ * block_chunk_size: chunk_size_of for a block known not to be a slab object.  The header is
+ * read without the arena's lock, which other threads may hold while they rewrite it: freeing
+ * or allocating the block below flips PREV_ALLOC, and reserve_reclaim cuts a reserved block
+ * down, clearing RESERVED in the same store.  Those stores are atomic, so the header read is
+ * one or the other, and either way the size is the block's own unless RESERVED is set.
+ */
+static size_t block_chunk_size(void *bp){
+  word_t hdr = GET_SHARED(HDRP(bp));
+
+#if SLAB_MAX > 0
+  if ((hdr & ~0x7) <= SLAB_MAX)
+    return 0;
+#endif
+  if (hdr & RESERVED)
+    return 0;
+  return hdr & ~0x7;
+}
+
+/*
+ * tcache_flush: Hands the first n blocks of a bin back to their arenas.  An arena's lock is
+ * held across consecutive blocks of that arena, so a bin of blocks from one arena takes it
+ * once.
+ */
+static void tcache_flush(int bin, unsigned int n){
+  arena_t *locked = NULL;
+  char *bp;
+
+  while (n-- > 0 && (bp = tcache.head[bin]) != NULL) {
+    tcache.head[bin] = *(char **)bp;
+    tcache.count[bin]--;
+    arena = arena_of(bp);
+    if (arena != locked) {
+      if (locked)
+        UNLOCK(locked);
+      LOCK(arena);
+      remote_drain();
+      locked = arena;
+    }
+    heap_free(bp);
+  }
+  if (locked)
+    UNLOCK(locked);
+}
+
+/*
+ * tcache_release: Thread exit destructor that empties the exiting thread's cache.
+ */
+static void tcache_release(void *arg){
+  for (int bin = 0; bin < TCACHE_BINS; bin++)
+    if (tcache.count[bin] > 0)
+      tcache_flush(bin, tcache.count[bin]);
+}
+
+static void tcache_key_init(void){
+  pthread_key_create(&tcache_key, tcache_release);
+}
+
+/*
+ * tcache_put: Caches a block of chunk size csize freed by this thread.  Returns false if
+ * blocks of that size (or of chunk size 0) are not cached.
+ */
+static bool tcache_put(void *bp, size_t csize){
+  int bin = csize / ALIGNMENT - 1;
+
+  if (csize == 0 || csize > TCACHE_MAX)
+    return false;
+  if (!tcache.registered) {
+    pthread_once(&tcache_once, tcache_key_init);
+    pthread_setspecific(tcache_key, &tcache);
+    tcache.registered = 1;
+  }
+  *(char **)bp = tcache.head[bin];
+  tcache.head[bin] = bp;
+  if (++tcache.count[bin] > TCACHE_COUNT)
+    tcache_flush(bin, TCACHE_BATCH);
+  return true;
+}
+
+/*
+ * tcache_get: Takes a cached block for a request of size bytes, or returns null.
+ */
+static void *tcache_get(size_t size){
+  size_t csize = chunk_size(size);
+  int bin = csize / ALIGNMENT - 1;
+  char *bp;
+
+  if (csize > TCACHE_MAX || (bp = tcache.head[bin]) == NULL)
+    return NULL;
+  tcache.head[bin] = *(char **)bp;
+  tcache.count[bin]--;
+  return bp;
+}
+
+/*
+ * remote_push: Queues block bp for the current arena, which the calling thread does not
+ * allocate from, without taking its lock.  Drains the stack if it has reached REMOTE_LIMIT
+ * blocks and the lock is free.
+ */
+static void remote_push(void *bp){
+  char *head = __atomic_load_n(&arena->remote_frees, __ATOMIC_RELAXED);
+
+  do
+    *(char **)bp = head;
+  while (!__atomic_compare_exchange_n(&arena->remote_frees, &head, bp, true,
+                                      __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+  if (__atomic_add_fetch(&arena->remote_count, 1, __ATOMIC_RELAXED) >= REMOTE_LIMIT &&
+      pthread_mutex_trylock(&arena->lock) == 0) {
+    remote_drain();
+    UNLOCK(arena);
+  }
+}
+
+/*
+ * remote_drain: Frees every block queued on the current arena by other threads.  Caller
+ * holds the arena's lock.  The stack is usually empty, so a relaxed load checks that before
+ * the exchange takes the cache line for writing.
+ */
+static void remote_drain(void){
+  char *bp, *next;
+  unsigned int n = 0;
+
+  if (__atomic_load_n(&arena->remote_frees, __ATOMIC_RELAXED) == NULL)
+    return;
+  bp = __atomic_exchange_n(&arena->remote_frees, NULL, __ATOMIC_ACQUIRE);
+  for (; bp != NULL; bp = next, n++) {
+    next = *(char **)bp;
+    heap_free(bp);
+  }
+  __atomic_sub_fetch(&arena->remote_count, n, __ATOMIC_RELAXED);
+}
+#endif
+
+/*
+ * mm_malloc: Allocates size bytes, from this thread's cache if it has a block of the right
+ * size and otherwise from the heap.  Blocks other threads freed to the arena are reclaimed
+ * first.  Large requests, and any request the heap has no room for, are mapped.
+ */
+void *mm_malloc(size_t size)
+{
+  void *bp;
+
+  /* Ignore spurious requests. */
+  if (size == 0)
+    return (NULL);
+
+  if (size >= __atomic_load_n(&mmap_threshold, __ATOMIC_RELAXED))
+    return map_block(size, ALIGNMENT);
+#if THREADED
+  if ((bp = tcache_get(size)) != NULL)
+    return bp;
+  arena = get_thread_arena();
+#endif
+  LOCK(arena);
+#if THREADED
+  remote_drain();
+#endif
+  bp = heap_malloc(size);
+  UNLOCK(arena);
+#if THREADED
+  /* an extra arena that is out of room leaves the request to main_arena */
+  if (bp == NULL && arena != &main_arena) {
+    arena = &main_arena;
+    LOCK(arena);
+    remote_drain();
+    bp = heap_malloc(size);
+    UNLOCK(arena);
+  }
+#endif
+  /* and when the heap cannot grow any more, the request gets a mapping of its own */
+  if (bp == NULL)
+    bp = map_block(size, ALIGNMENT);
+  return bp;
+}
+
+/*
+ * heap_malloc: Allocates size bytes from the heap.  Small requests come from the slab layer,
+ * everything else from the boundary-tag heap through alloc_block.  Caller holds the lock of
+ * the current arena.
+ */
+static void *heap_malloc(size_t size)
+{
+#if SLAB_MAX > 0
+  if (size <= SLAB_MAX)
+    return slab_alloc(size);
+#endif
+  return alloc_block(size);
+}
+
+/*
+ * alloc_block: Allocates a block by incrementing the brk pointer while preserving alignment.
+ * After adjusting block size to include necessary headers/footers/match alignment, takes a
+ * fast block of that size or searches the free list for a fit (see fit_block).  If no fit is
+ * found, the heap is extended and the block is allocated to the end of the heap.
+ */
+//*****Begin Textbook Code*****
+static void *alloc_block(size_t size)
+{
+  size_t asize;      /* Adjusted block size */
+  void *bp;
+    
+  /* Adjust block size to include overhead and alignment reqs. */
+  asize = ADJUSTED_SIZE(size);
+
+#if FASTBIN_MAX > 0
+  /* A fast block of exactly this size needs neither a search nor a split. */
+  if (asize <= FASTBIN_MAX && (bp = fast_pop(asize)) != NULL)
+    return (bp);
+#endif
+    
+  /* Search the free list for a fit. */
+  if ((bp = fit_block(asize)) != NULL) {
+    place(bp, asize);
+    return (bp);
+  }
+    
+  /* No fit found.  Get more memory and place the block. */
+  if ((bp = grow_heap(asize)) == NULL)
+    return (NULL);
+  place(bp, asize);
+
+  //if (CHECK && CHECK_MALLOC)
+  //mm_check('a', bp, checksize);
+
+  return (bp);
+}
+//*****End Textbook Code*****
+
+/*
+ * fit_block: Returns a free block of at least asize bytes from find_fit.  If there is none,
+ * the fast bins are consolidated and then the realloc reserves reclaimed, before the caller
+ * has to grow the heap, searching again after each.  Returns null if that finds nothing.
+ */
+static void *fit_block(size_t asize){
+  void *bp;
+
+  if ((bp = find_fit(asize)) != NULL)
+    return bp;
+#if FASTBIN_MAX > 0
+  if (arena->fast_blocks > 0) {
+    fast_consolidate();
+    if ((bp = find_fit(asize)) != NULL)
+      return bp;
+  }
+#endif
+  /* only worth a walk of the heap if the slack could be enough */
+  if (arena->reserved >= asize) {
+    reserve_reclaim();
+    bp = find_fit(asize);
+  }
+  return bp;
+}
+
+/*
+ * mm_memalign: Allocates size bytes whose address is a multiple of align, which must be a power
+ * of two, or returns null.  The block comes from a free block with a suitably aligned spot in
+ * it, or from the top of the heap (see aligned_block), so no more than the block itself is used
+ * up, and it is freed and resized like any other.  Large requests get a mapping of their own
+ * that starts with align bytes of lead.
+ */
+void *mm_memalign(size_t align, size_t size)
+{
+  void *bp;
+
+  if (size == 0 || align == 0 || (align & (align - 1)) != 0)
+    return NULL;
+  if (align <= ALIGNMENT)
+    return mm_malloc(size);
+  if (size >= __atomic_load_n(&mmap_threshold, __ATOMIC_RELAXED))
+    return map_block(size, align);
+#if THREADED
+  arena = get_thread_arena();
+#endif
+  LOCK(arena);
+#if THREADED
+  remote_drain();
+#endif
+  bp = aligned_block(ADJUSTED_SIZE(size), align, 0);
+  UNLOCK(arena);
+#if THREADED
+  if (bp == NULL && arena != &main_arena) {
+    arena = &main_arena;
+    LOCK(arena);
+    remote_drain();
+    bp = aligned_block(ADJUSTED_SIZE(size), align, 0);
+    UNLOCK(arena);
+  }
+#endif
+  if (bp == NULL)
+    bp = map_block(size, align);
+  return bp;
+}
+
+/*
+ * aligned_block: Places a block of asize bytes whose payload lies a multiple of align bytes past
+ * base, and returns it or null.  The block comes from the fit for asize if that has an aligned
+ * spot, else from a free block big enough to have one wherever it lies, else from extending the
+ * heap just far enough past its top (or the free block at its top), which keeps runs created
+ * one after another back to back.  Any gap in front of the block is split off as a free block
+ * of its own and place splits off the rest.  Caller holds the lock of the current arena.
+ */
+static void *aligned_block(size_t asize, size_t align, size_t base){
+  char *bp, *ap, *top, *brk;
+  size_t csize;
+
+  bp = find_fit(asize);
+  if (bp == NULL || (ap = aligned_spot(bp, align, base)) + asize > bp + GET_SIZE(HDRP(bp))) {
+    if ((bp = fit_block(asize + align + MIN_BLOCK_SIZE)) != NULL)
+      ap = aligned_spot(bp, align, base);
+    else {
+      /* Use the free block at the top of the heap if there is one, else start at brk, and
+         extend the heap just far enough for the block to fit */
+      brk = arena->brk;
+      top = GET_PREV_ALLOC(brk - WSIZE) ? brk : brk - GET_SIZE(brk - DSIZE);
+      ap = aligned_spot(top, align, base);
+      if (ap + asize > brk && extend_heap((ap + asize - brk) / WSIZE) == NULL)
+        return NULL;
+      bp = top;
+    }
+  }
+
+  if (ap != bp) {
+    csize = GET_SIZE(HDRP(bp));
+    remove_from_free_list(bp);
+    PUT(HDRP(bp), PACK(ap - bp, 0) | GET_PREV_ALLOC(HDRP(bp)));
+    PUT(FTRP(bp), PACK(ap - bp, 0));
+    insert_in_free_list(bp);
+    PUT(HDRP(ap), PACK(csize - (ap - bp), 0));
+    PUT(FTRP(ap), PACK(csize - (ap - bp), 0));
+    insert_in_free_list(ap);
+  }
+  place(ap, asize);
+  return ap;
+}
+
+/*
+ * aligned_spot: Returns the first payload address from bp on that lies a multiple of align bytes
+ * past base and leaves either no gap in front of it or one big enough to be a free block.
+ */
+static char *aligned_spot(char *bp, size_t align, size_t base){
+  char *ap = (char *)((((size_t)bp - base + align - 1) & ~(align - 1)) + base);
+
+  while (ap != bp && ap - bp < MIN_BLOCK_SIZE)
+    ap += align;
+  return ap;
+}
+
+/*
+ * mm_malloc_batch: Allocates n blocks of size bytes each and stores them in ptrs.  Blocks of the
+ * heap are carved back to back out of as few free blocks as possible, each taken with a single
+ * free list update.  Returns the number of blocks allocated, which is less than n only if
+ * memory ran out; each one must still be freed on its own or with mm_free_batch.
+ */
+size_t mm_malloc_batch(size_t size, size_t n, void **ptrs)
+{
+  size_t i = 0;
+
+  if (size == 0 || n == 0)
+    return 0;
+  if (size < __atomic_load_n(&mmap_threshold, __ATOMIC_RELAXED)) {
+#if THREADED
+    arena = get_thread_arena();
+#endif
+    LOCK(arena);
+#if THREADED
+    remote_drain();
+#endif
+    i = heap_malloc_batch(size, n, ptrs);
+    UNLOCK(arena);
+  }
+  /* whatever the arena had no room for goes the way of a single request */
+  for (; i < n; i++)
+    if ((ptrs[i] = mm_malloc(size)) == NULL)
+      break;
+  return i;
+}
+
+/*
+ * heap_malloc_batch: Allocates up to n blocks of size bytes from the current arena into ptrs
+ * and returns how many it got.  Caller holds the lock of the current arena.
+ */
+static size_t heap_malloc_batch(size_t size, size_t n, void **ptrs)
+{
+  size_t asize, k, i = 0;
+  void *bp;
+
+#if SLAB_MAX > 0
+  if (size <= SLAB_MAX) {
+    while (i < n && (ptrs[i] = slab_alloc(size)) != NULL)
+      i++;
+    return i;
+  }
+#endif
+  asize = ADJUSTED_SIZE(size);
+#if FASTBIN_MAX > 0
+  while (i < n && asize <= FASTBIN_MAX && (ptrs[i] = fast_pop(asize)) != NULL)
+    i++;
+#endif
+  while (i < n) {
+    /* one fit for all of the rest, or else for as many as the first fit holds; only the
+       second search consolidates, and only when no free block holds even one */
+    k = n - i;
+    if ((bp = find_fit(k * asize)) == NULL && (bp = fit_block(asize)) == NULL &&
+        (bp = grow_heap(k * asize)) == NULL)
+      break;
+    k = MIN(k, GET_SIZE(HDRP(bp)) / asize);
+    place_batch(bp, asize, k, ptrs + i);
+    i += k;
+  }
+  return i;
+}
+
+/*
+ * place_batch: Carves k blocks of asize bytes, back to back, from the front of free block bp
+ * and stores them in ptrs.  As with place, what is left stays free if it is big enough to be a
+ * block, and otherwise goes to the last of the k blocks.
+ */
+static void place_batch(void *bp, size_t asize, size_t k, void **ptrs){
+  size_t csize = GET_SIZE(HDRP(bp));
+  size_t prev_alloc = GET_PREV_ALLOC(HDRP(bp));
+
+  remove_from_free_list(bp);
+  arena->allocated += k * asize;
+  for (size_t j = 0; j < k - 1; j++) {
+    PUT(HDRP(bp), PACK(asize, 1) | prev_alloc);
+    ptrs[j] = bp;
+    bp = NEXT_BLKP(bp);
+    csize -= asize;
+    prev_alloc = PREV_ALLOC;
+  }
+  ptrs[k - 1] = bp;
+  if ((csize - asize) >= MIN_BLOCK_SIZE) {
+    PUT(HDRP(bp), PACK(asize, 1) | prev_alloc);
+    bp = NEXT_BLKP(bp);
+    PUT(HDRP(bp), PACK(csize-asize, 0) | PREV_ALLOC);
+    PUT(FTRP(bp), PACK(csize-asize, 0));
+    insert_in_free_list(bp);
+  }
+  else {
+    PUT(HDRP(bp), PACK(csize, 1) | prev_alloc);
+    SET_PREV_ALLOC(HDRP(NEXT_BLKP(bp)));
+  }
+}
+
+/*
+ * mm_free: Frees the block pointed to by bp.  If bp is null, the function does nothing.
+ * Blocks of an arena this thread does not allocate from are queued for that arena, small
+ * blocks go to this thread's cache, and everything else back to the heap.
+ */
+void mm_free(void *bp)
+{
+  arena_t *a;
+
+  if (bp == NULL)
+    return;
+
+  if ((a = arena_of(bp)) == NULL) {
+    unmap_block(bp);
+    return;
+  }
+  arena = a;
+#if THREADED
+  if (REMOTE_FREE && arena != thread_arena) {
+    remote_push(bp);
+    return;
+  }
+  if (tcache_put(bp, chunk_size_of(bp)))
+    return;
+#endif
+  LOCK(arena);
+#if THREADED
+  remote_drain();
+#endif
+  heap_free(bp);
+  UNLOCK(arena);
+}
+
+/*
+ * mm_free_sized: Frees block bp, which the caller allocated (or last resized) for size bytes.
+ * The size saves one of the lookups mm_free makes: a block too big to be a slab object skips
+ * the run_map test.  The cache bin is still taken from the object's run or the block's header,
+ * since a shrinking realloc leaves either bigger than size calls for.
+ * Built with -DCHECK=1, the size is checked against the block, under the arena's lock.
+ */
+void mm_free_sized(void *bp, size_t size)
+{
+  arena_t *a;
+
+  if (bp == NULL)
+    return;
+#if CHECK
+  assert(size <= mm_usable_size(bp));
+#endif
+
+  if ((a = arena_of(bp)) == NULL) {
+    unmap_block(bp);
+    return;
+  }
+  arena = a;
+#if THREADED
+  if (REMOTE_FREE && arena != thread_arena) {
+    remote_push(bp);
+    return;
+  }
+#endif
+#if SLAB_MAX > 0
+  if (size <= SLAB_MAX && is_slab(bp)) {
+#if THREADED
+    if (tcache_put(bp, RUN_OF(bp)->objsize))
+      return;
+#endif
+    LOCK(arena);
+#if THREADED
+    remote_drain();
+#endif
+    slab_free(bp);
+    UNLOCK(arena);
+    return;
+  }
+#endif
+#if THREADED
+  if (tcache_put(bp, block_chunk_size(bp)))
+    return;
+#endif
+  LOCK(arena);
+#if THREADED
+  remote_drain();
+#endif
+  heap_free_block(bp);
+  UNLOCK(arena);
+}
+
+/*
+ * mm_usable_size: Returns how many bytes block bp can hold, which may be more than were asked
+ * for, or 0 if bp is null.  The caller may use all of them.  A block with a realloc reserve
+ * reports only the part it uses, since its slack can be taken back.
+ */
+size_t mm_usable_size(void *bp)
+{
+  size_t size;
+  arena_t *a;
+
+  if (bp == NULL)
+    return 0;
+  if ((a = arena_of(bp)) == NULL)
+    return GET_SIZE(HDRP(bp)) - MAP_HDR_SIZE - MAP_LEAD(bp);
+  arena = a;
+#if SLAB_MAX > 0
+  if (is_slab(bp))
+    return RUN_OF(bp)->objsize;
+#endif
+  LOCK(arena);    /* reserve_reclaim can cut the block down meanwhile */
+  size = GET_RESERVED(HDRP(bp)) ? RESERVE_USED(bp) : GET_SIZE(HDRP(bp));
+  UNLOCK(arena);
+  return size - WSIZE;
+}
+
+/*
+ * heap_free: Returns bp to the heap.  Slab objects go back to their run, small blocks to their
+ * fast bin and everything else, realloc reserve included, to free_block.  Caller holds the lock of bp's arena, which is
+ * the current one.
+ */
+static void heap_free(void *bp)
+{
+#if SLAB_MAX > 0
+  if (is_slab(bp)) {
+    slab_free(bp);
+    return;
+  }
+#endif
+  heap_free_block(bp);
+}
+
+/*
+ * heap_free_block: heap_free for a block known not to be a slab object.
+ */
+static void heap_free_block(void *bp)
+{
+  if (GET_RESERVED(HDRP(bp)))
+    reserve_clear(bp);
+#if FASTBIN_MAX > 0
+  size_t size = GET_SIZE(HDRP(bp));
+
+  if (size <= FASTBIN_MAX && fast_push(bp))
+    return;
+  free_block(bp);
+  if (size >= FAST_CONSOLIDATE_SIZE && arena->fast_blocks > 0)
+    fast_consolidate();
+#else
+  free_block(bp);
+#endif
+}
+
+/*
+ * free_block: Adjusts the block's header and footer to mark it as free and coalesces the
+ * block.  A free block of more than trim_threshold bytes left at the top of the heap is
+ * trimmed.
+ */
+//*****Begin Textbook Code*****
+static void free_block(void *bp)
+{
+  size_t size = GET_SIZE(HDRP(bp));
+    
+  PUT(HDRP(bp), PACK(size, 0) | GET_PREV_ALLOC(HDRP(bp)));
+  PUT(FTRP(bp), PACK(size, 0));
+  CLEAR_PREV_ALLOC(HDRP(NEXT_BLKP(bp)));
+  bp = coalesce(bp);
+  if (GET_SIZE(HDRP(bp)) > __atomic_load_n(&trim_threshold, __ATOMIC_RELAXED) &&
+      GET_SIZE(HDRP(NEXT_BLKP(bp))) == 0)
+    heap_trim(TRIM_PAD);
+}
+//*****End Textbook Code*****
+
+/*
+ * mm_free_batch: Frees the n blocks in ptrs, skipping null pointers.  ptrs is sorted by address
+ * first, so the blocks of each arena are freed under one lock and blocks that lie back to back
+ * in the heap are merged into one before they are freed, which leaves coalesce a single pass
+ * over each run of them.  The order of ptrs is not preserved.
+ */
+void mm_free_batch(void **ptrs, size_t n)
+{
+  size_t i, j;
+  arena_t *a;
+
+  ptrs_sort(ptrs, n);
+  for (i = 0; i < n; i = j) {
+    j = i + 1;
+    if (ptrs[i] == NULL)
+      continue;
+    if ((a = arena_of(ptrs[i])) == NULL) {
+      unmap_block(ptrs[i]);
+      continue;
+    }
+    while (j < n && arena_of(ptrs[j]) == a)
+      j++;
+    arena = a;
+    LOCK(arena);
+#if THREADED
+    remote_drain();
+#endif
+    heap_free_batch(ptrs + i, j - i);
+    UNLOCK(arena);
+  }
+}
+
+/*
+ * heap_free_batch: Frees the n blocks in ptrs, sorted by address, to the current arena.  Each
+ * run of blocks that follow one another directly becomes a single allocated block, which
+ * heap_free then frees like any other.  Caller holds the lock of the current arena.
+ */
+static void heap_free_batch(void **ptrs, size_t n)
+{
+  size_t i, j, size;
+  char *bp;
+
+  for (i = 0; i < n; i = j) {
+    bp = ptrs[i];
+    j = i + 1;
+#if SLAB_MAX > 0
+    if (is_slab(bp)) {
+      slab_free(bp);
+      continue;
+    }
+#endif
+    if (GET_RESERVED(HDRP(bp)))
+      reserve_clear(bp);
+    size = GET_SIZE(HDRP(bp));
+    /* a slab object never starts where a block does, a run_t is there */
+    for (; j < n && (char *)ptrs[j] == bp + size; j++) {
+      if (GET_RESERVED(HDRP(ptrs[j])))
+        reserve_clear(ptrs[j]);
+      size += GET_SIZE(HDRP(ptrs[j]));
+    }
+    if (j > i + 1)
+      PUT(HDRP(bp), PACK(size, 1) | GET_PREV_ALLOC(HDRP(bp)));
+    heap_free(bp);
+  }
+}
+
+/*
+ * ptrs_sort: Sorts the n pointers in ptrs by address.  The arrays mm_malloc_batch hands out
+ * are usually in order already (carved blocks) or in reverse (slab objects, which come off
+ * LIFO lists), so those two cases take a single pass.
+ */
+static void ptrs_sort(void **ptrs, size_t n){
+  size_t i, up = 1, down = 1;
+  void *p;
+
+  for (i = 1; i < n; i++) {
+    up += (char *)ptrs[i - 1] <= (char *)ptrs[i];
+    down += (char *)ptrs[i - 1] >= (char *)ptrs[i];
+  }
+  if (up >= n)
+    return;
+  if (down >= n) {
+    for (i = 0; i < n / 2; i++) {
+      p = ptrs[i];
+      ptrs[i] = ptrs[n - 1 - i];
+      ptrs[n - 1 - i] = p;
+    }
+    return;
+  }
+  qsort(ptrs, n, sizeof(void *), ptr_compare);
+}
+
+/*
+ * ptr_compare: qsort comparison of two pointers by address.
+ */
+static int ptr_compare(const void *a, const void *b){
+  char *p = *(char * const *)a, *q = *(char * const *)b;
+
+  return (p > q) - (p < q);
+}
+
+/*
+ * mm_realloc: Returns a pointer to an unallocated region of at least size bytes.
+ * If the size is too big for a header to describe, the function returns NULL
+ * If the size is equal to 0, the function acts as mm_free
+ * If bp is null, the function acts as mm_malloc
+ * Otherwise the block is resized in place whenever it can be (see heap_realloc), and only
+ * moved to a new block as a last resort.  The whole call holds the lock of bp's arena, and a
+ * moved block stays in it unless it is large enough to be mapped.  A large block is resized
+ * by remapping it.
+ */
+void *mm_realloc(void *bp, size_t size)
+{
+  void *new_ptr;
+  arena_t *a;
+
+  if (bp == NULL)
+    return mm_malloc(size);
+  if ((a = arena_of(bp)) == NULL) {
+    if (size == 0) {
+      unmap_block(bp);
+      return NULL;
+    }
+    return remap_block(bp, size);
+  }
+  arena = a;
+  LOCK(arena);
+  new_ptr = heap_realloc(bp, size);
+  UNLOCK(arena);
+  return new_ptr;
+}
+
+/*
+ * heap_realloc: Resizes block bp of the current arena to hold size bytes.  A reserved block
+ * that still fits its block just records its new size.  Otherwise heap_realloc tries, in turn,
+ * to
+ * - shrink it in place, freeing the tail if that is big enough to be a block,
+ * - grow it into the free block after it,
+ * - grow the heap under it if it is the last block (or only a free block follows it),
+ * - grow it into the free block before it (and the one after, if needed), moving the
+ *   payload down with memmove,
+ * and only then moves it to a new block, copying just the old payload.  A block that grows by
+ * a step takes up to RESERVE_SIZE bytes where it grows, as a realloc reserve.  A slab object stays
+ * put while the new size still fits its class.  Caller holds the lock of the current arena.
+ */
+static void *heap_realloc(void *bp, size_t size)
+{
+  size_t asize, rsize, oldsize, used, csize, prev_size = 0, next_size = 0;
+  char *next, *prev;
+
+  if(size >= MAP_MAX)
+    return NULL;
+  if(size == 0){
+    heap_free(bp);
+    return NULL;
+  }
+#if SLAB_MAX > 0
+  if (is_slab(bp)) {
+    size_t objsize = RUN_OF(bp)->objsize;
+
+    if (size <= objsize)
+      return bp;
+    return realloc_move(bp, size, objsize);
+  }
+#endif
+  asize = ADJUSTED_SIZE(size);
+  oldsize = used = GET_SIZE(HDRP(bp));
+  if (GET_RESERVED(HDRP(bp))) {
+    used = reserve_clear(bp);
+    if (asize > used && asize <= oldsize) {
+      reserve_set(bp, asize);
+      return bp;
+    }
+  }
+  if (asize <= oldsize) {
+    realloc_split(bp, asize);
+    return bp;
+  }
+  rsize = GROWS_BY_STEP(used, asize) ? RESERVE_SIZE(asize) : asize;
+
+  next = NEXT_BLKP(bp);
+  if (!GET_ALLOC(HDRP(next)))
+    next_size = GET_SIZE(HDRP(next));
+  if (!GET_PREV_ALLOC(HDRP(bp)))
+    prev_size = GET_SIZE((char *)bp - DSIZE);
+
+  /* At the top of the heap, extend it by just what is missing; the new space joins next */
+  if (oldsize + next_size < asize &&
+      GET_SIZE(HDRP(next_size ? NEXT_BLKP(next) : next)) == 0 &&
+      extend_heap((asize - oldsize - next_size) / WSIZE) != NULL)
+    next_size = GET_SIZE(HDRP(next));
+
+  if (oldsize + next_size >= asize) {
+    csize = oldsize + next_size;
+    remove_from_free_list(next);
+    PUT(HDRP(bp), PACK(csize, 1) | GET_PREV_ALLOC(HDRP(bp)));
+    SET_PREV_ALLOC(HDRP(NEXT_BLKP(bp)));
+    realloc_split(bp, MIN(csize, rsize));
+    reserve_set(bp, asize);
+    return bp;
+  }
+
+  if (prev_size + oldsize + next_size >= asize) {
+    prev = PREV_BLKP(bp);
+    csize = prev_size + oldsize + next_size;
+    remove_from_free_list(prev);
+    if (next_size)
+      remove_from_free_list(next);
+    PUT(HDRP(prev), PACK(csize, 1) | GET_PREV_ALLOC(HDRP(prev)));
+    SET_PREV_ALLOC(HDRP(NEXT_BLKP(prev)));
+    memmove(prev, bp, used - WSIZE);
+    realloc_split(prev, MIN(csize, rsize));
+    reserve_set(prev, asize);
+    return prev;
+  }
+
+  return realloc_move(bp, size, used - WSIZE);
+}
+
+/*
+ * realloc_split: Cuts allocated block bp down to asize bytes, freeing the rest as a block of
+ * its own if it is big enough to be one.
+ */
+static void realloc_split(void *bp, size_t asize){
+  size_t csize = GET_SIZE(HDRP(bp));
+
+  if (csize - asize >= MIN_BLOCK_SIZE) {
+    PUT_SHARED(HDRP(bp), PACK(asize, 1) | GET_PREV_ALLOC(HDRP(bp)));
+    PUT(HDRP(NEXT_BLKP(bp)), PACK(csize - asize, 1) | PREV_ALLOC);
+    free_block(NEXT_BLKP(bp));
+  }
+}
+
+/*
+ * realloc_move: Moves bp to a new block (or mapping) of size bytes, copying the first copy
+ * bytes of the payload, and frees bp.  A block that grows by a step gets a realloc reserve
+ * if it moves within the heap.
+ * Returns null, leaving bp alone, if there is no room.
+ */
+static void *realloc_move(void *bp, size_t size, size_t copy){
+  size_t threshold = __atomic_load_n(&mmap_threshold, __ATOMIC_RELAXED);
+  size_t asize = ADJUSTED_SIZE(size), rsize = size;   /* rsize: payload, slack included */
+  void *new_ptr = NULL;
+
+  if (GROWS_BY_STEP(copy + WSIZE, asize))
+    rsize = MIN(RESERVE_SIZE(asize) - WSIZE, threshold - 1);
+  if (size < threshold && (new_ptr = heap_malloc(rsize)) != NULL && rsize > SLAB_MAX)
+    reserve_set(new_ptr, asize);
+  if (new_ptr == NULL && (new_ptr = map_block(size, ALIGNMENT)) == NULL)
+    return NULL;
+  memcpy(new_ptr, bp, MIN(copy, size));
+  heap_free(bp);
+  return new_ptr;
+}
+
+/*
+ * reserve_set: Marks allocated block bp, which uses used bytes of its block, as reserved if
+ * the rest is big enough to be freed as a block of its own.
+ */
+static void reserve_set(void *bp, size_t used){
+  size_t size = GET_SIZE(HDRP(bp));
+
+  if (size - used < MIN_BLOCK_SIZE)
+    return;
+  PUT(HDRP(bp), GET(HDRP(bp)) | RESERVED);
+  PUT(FTRP(bp), used);
+  arena->reserved += size - used;
+}
+
+/*
+ * reserve_clear: Drops the reserve of block bp, leaving the slack in the block, and returns
+ * the size the block uses.
+ */
+static size_t reserve_clear(void *bp){
+  size_t used = RESERVE_USED(bp);
+
+  PUT_SHARED(HDRP(bp), GET(HDRP(bp)) & ~RESERVED);
+  arena->reserved -= GET_SIZE(HDRP(bp)) - used;
+  return used;
+}
+
+/*
+ * reserve_reclaim: Cuts every reserved block of the current arena back to the size it uses,
+ * freeing the slack.  A block is cut before its reserve is dropped, so the header another
+ * thread reads in block_chunk_size never has RESERVED clear and the old size.
+ */
+static void reserve_reclaim(void){
+  char *bp;
+  size_t used;
+
+  if (arena->reserved == 0)
+    return;
+  for (bp = arena->heap_start + 4 * WSIZE; GET_SIZE(HDRP(bp)) > 0; bp = NEXT_BLKP(bp))
+    if (GET_RESERVED(HDRP(bp))) {
+      used = RESERVE_USED(bp);
+      arena->reserved -= GET_SIZE(HDRP(bp)) - used;
+      realloc_split(bp, used);
+      if (GET_RESERVED(HDRP(bp)))
+        PUT_SHARED(HDRP(bp), GET(HDRP(bp)) & ~RESERVED);
+    }
+}
+
+#if FASTBIN_MAX > 0
+/*
+ * fast_push: Puts block bp of the current arena on its fast bin, still marked allocated, and
+ * consolidates the bins once that one is over FASTBIN_LIMIT blocks.  Returns false, leaving
+ * bp alone, if bp borders free space or the end of the heap: such a block is better merged
+ * at once than left splitting free memory and holding off heap_trim.
+ */
+static bool fast_push(void *bp){
+  int bin = FASTBIN(GET_SIZE(HDRP(bp)));
+  char *next = NEXT_BLKP(bp);
+
+  if (!GET_PREV_ALLOC(HDRP(bp)) || !GET_ALLOC(HDRP(next)) || GET_SIZE(HDRP(next)) == 0)
+    return false;
+  *(char **)bp = arena->fastbins[bin];
+  arena->fastbins[bin] = bp;
+  arena->fast_blocks++;
+  if (++arena->fast_count[bin] > FASTBIN_LIMIT)
+    fast_consolidate();
+  return true;
+}
+
+/*
+ * fast_pop: Takes a fast block of exactly asize bytes, or returns null.
+ */
+static void *fast_pop(size_t asize){
+  int bin = FASTBIN(asize);
+  char *bp;
+
+  if ((bp = arena->fastbins[bin]) == NULL)
+    return NULL;
+  arena->fastbins[bin] = *(char **)bp;
+  arena->fast_count[bin]--;
+  arena->fast_blocks--;
+  return bp;
+}
+
+/*
+ * fast_consolidate: Empties every fast bin of the current arena into free_block, which
+ * coalesces the blocks.
+ */
+static void fast_consolidate(void){
+  char *bp;
+
+  for (int bin = 0; bin < FASTBINS && arena->fast_blocks > 0; bin++) {
+    while ((bp = arena->fastbins[bin]) != NULL) {
+      arena->fastbins[bin] = *(char **)bp;
+      free_block(bp);
+    }
+    arena->fast_blocks -= arena->fast_count[bin];
+    arena->fast_count[bin] = 0;
+  }
+}
+#endif
+
+/*
+ * mm_region_create: Returns a new, empty region, or null if there is no memory for it.
+ */
+mm_region_t *mm_region_create(void)
+{
+  char *chunk;
+  mm_region_t *r;
+
+  if ((chunk = mm_malloc(REGION_CHUNK)) == NULL)
+    return NULL;
+  *(char **)chunk = NULL;
+  r = (mm_region_t *)(chunk + CHUNK_HDR_SIZE);
+  r->chunks = chunk;
+  r->next = chunk + CHUNK_HDR_SIZE + ALIGN(sizeof(mm_region_t));
+  r->end = chunk + REGION_CHUNK;
+  r->chunk_size = 2 * REGION_CHUNK;
+  return r;
+}
+
+/*
+ * mm_region_alloc: Allocates size bytes from region r, aligned like mm_malloc's blocks.  The
+ * memory lasts until the region is destroyed.  Returns null if size is 0 or out of memory.
+ */
+void *mm_region_alloc(mm_region_t *r, size_t size)
+{
+  char *bp;
+
+  if (size == 0)
+    return NULL;
+  size = ALIGN(size);
+  if (size > (size_t)(r->end - r->next))
+    return region_grow(r, size);
+  bp = r->next;
+  r->next += size;
+  return bp;
+}
+
+/*
+ * region_grow: Allocates size bytes, already aligned, from a new chunk of region r.  Only a
+ * chunk that is not reserved for the request alone becomes the one to bump through.
+ */
+static void *region_grow(mm_region_t *r, size_t size){
+  size_t csize = CHUNK_HDR_SIZE + size;
+  char *chunk;
+
+  if (csize > r->chunk_size / 2) {
+    if ((chunk = mm_malloc(csize)) == NULL)
+      return NULL;
+    *(char **)chunk = *(char **)r->chunks;
+    *(char **)r->chunks = chunk;
+    return chunk + CHUNK_HDR_SIZE;
+  }
+  if ((chunk = mm_malloc(r->chunk_size)) == NULL)
+    return NULL;
+  *(char **)chunk = r->chunks;
+  r->chunks = chunk;
+  r->next = chunk + csize;
+  r->end = chunk + r->chunk_size;
+  r->chunk_size = MIN(2 * r->chunk_size, REGION_CHUNK_MAX);
+  return chunk + CHUNK_HDR_SIZE;
+}
+
+/*
+ * mm_region_destroy: Frees region r and everything allocated from it.
+ */
+void mm_region_destroy(mm_region_t *r)
+{
+  char *chunk = r->chunks, *prev;
+
+  while (chunk != NULL) {
+    prev = *(char **)chunk;
+    mm_free(chunk);
+    chunk = prev;
+  }
 }
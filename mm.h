@@ -0,0 +1,34 @@
+#include <stdio.h>
+
+extern int mm_init (void);
+extern void *mm_malloc (size_t size);
+extern void mm_free (void *ptr);
+extern void mm_free_sized(void *ptr, size_t size);
+extern size_t mm_usable_size(void *ptr);
+extern size_t mm_malloc_batch(size_t size, size_t n, void **ptrs);
+extern void mm_free_batch(void **ptrs, size_t n);
+extern void *mm_realloc(void *ptr, size_t size);
+extern void *mm_memalign(size_t align, size_t size);
+extern int mm_trim(size_t pad);
+
+typedef struct mm_region mm_region_t;
+extern mm_region_t *mm_region_create(void);
+extern void *mm_region_alloc(mm_region_t *r, size_t size);
+extern void mm_region_destroy(mm_region_t *r);
+
+
+/* 
+ * Students work in teams of one or two.  Teams enter their team name, 
+ * personal names and login IDs in a struct of this
+ * type in their bits.c file.
+ */
+typedef struct {
+    char *teamname; /* ID1+ID2 or ID1 */
+    char *name1;    /* full name of first member */
+    char *id1;      /* login ID of first member */
+    char *name2;    /* full name of second member (if any) */
+    char *id2;      /* login ID of second member */
+} team_t;
+
+extern team_t team;
+
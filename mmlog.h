@@ -0,0 +1,35 @@
+/*
+ * mmlog.h - Binary allocation log written by mmtrace.so and replayed
+ *           by mdriver -r
+ *
+ * A log is an mmlog_hdr_t followed by one mmlog_rec_t per call, in the
+ * order the calls returned.  All fields are 64 bits wide apart from the
+ * thread id and the type, so a log of a 64-bit program loses nothing.
+ * Blocks are identified by the address the traced program got back.
+ */
+#include <stdint.h>
+
+#define MMLOG_MAGIC   "MMLOG\0\0\0"  /* first 8 bytes of every log */
+#define MMLOG_VERSION 1
+
+/* Record types */
+#define MMLOG_MALLOC   1  /* ptr = malloc(size) */
+#define MMLOG_CALLOC   2  /* ptr = calloc(1, size) */
+#define MMLOG_REALLOC  3  /* ptr = realloc(old, size), old and size nonzero */
+#define MMLOG_MEMALIGN 4  /* ptr = memalign(old, size), and its relatives */
+#define MMLOG_FREE     5  /* free(ptr), ptr nonzero */
+
+typedef struct {
+    char magic[8];        /* MMLOG_MAGIC */
+    uint32_t version;     /* MMLOG_VERSION */
+    uint32_t recsize;     /* sizeof(mmlog_rec_t) */
+} mmlog_hdr_t;
+
+typedef struct {
+    uint64_t time;        /* nanoseconds since logging started */
+    uint64_t ptr;         /* block returned, or freed */
+    uint64_t old;         /* block resized by MMLOG_REALLOC, alignment of MMLOG_MEMALIGN */
+    uint64_t size;        /* bytes requested */
+    uint32_t tid;         /* kernel thread id of the caller */
+    uint32_t type;        /* MMLOG_MALLOC ... MMLOG_FREE */
+} mmlog_rec_t;
@@ -0,0 +1,293 @@
+/*
+ * mmtrace.c - LD_PRELOAD interposer that logs a program's heap calls
+ *
+ * Build mmtrace.so and run a program with it preloaded:
+ *
+ *     LD_PRELOAD=./mmtrace.so MMTRACE_LOG=app.%p.log ./app
+ *
+ * Every successful malloc, calloc, realloc, memalign, posix_memalign,
+ * aligned_alloc and free is passed on to glibc and recorded, with a
+ * timestamp and the caller's thread id, in the binary format of mmlog.h.
+ * mdriver -r replays the log against mm.c.  A %p in MMTRACE_LOG stands
+ * for the process id, so programs that fork and exec get a log per
+ * process; the default is mmtrace.%p.log.  A child that forks without
+ * exec stops logging, since it shares the parent's log.
+ *
+ * Records go through a buffer under one lock, which also orders them:
+ * the log is a serialization of the program's calls that glibc could
+ * have produced, so it replays correctly on a single thread.  Calls
+ * made before the constructor runs are not logged; the replay skips
+ * frees of blocks it never saw and treats a realloc of one as a malloc.
+ */
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+
+#include "mmlog.h"
+
+/* Records buffered between writes to the log */
+#define BUFRECS 4096
+
+/* glibc's own allocator, which never calls back into this file */
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void *__libc_memalign(size_t align, size_t size);
+extern void __libc_free(void *ptr);
+
+static int log_fd = -1;                 /* the log, or -1 when not logging */
+static mmlog_rec_t buf[BUFRECS];        /* records not yet written */
+static int nbuf;                        /* number of them */
+static struct timespec start;           /* when logging started */
+static pthread_mutex_t log_lock = PTHREAD_MUTEX_INITIALIZER;
+static __thread uint32_t tid           /* caller's thread id, 0 until looked up */
+    __attribute__((tls_model("initial-exec")));
+
+/*
+ * write_all - write n bytes to the log, retrying short writes.  Logging
+ *     stops if the log cannot be written.
+ */
+static void write_all(const void *p, size_t n)
+{
+    ssize_t r;
+
+    while (n > 0) {
+	if ((r = write(log_fd, p, n)) < 0) {
+	    if (errno == EINTR)
+		continue;
+	    close(log_fd);
+	    log_fd = -1;
+	    return;
+	}
+	p = (const char *)p + r;
+	n -= r;
+    }
+}
+
+/*
+ * flush - write out the buffered records, called with log_lock held
+ */
+static void flush(void)
+{
+    if (log_fd >= 0 && nbuf > 0)
+	write_all(buf, nbuf * sizeof(mmlog_rec_t));
+    nbuf = 0;
+}
+
+/*
+ * record - append one record to the log, called with log_lock held
+ */
+static void record(uint32_t type, void *ptr, uint64_t old, size_t size)
+{
+    struct timespec now;
+    mmlog_rec_t *r;
+
+    if (log_fd < 0)
+	return;
+    if (tid == 0)
+	tid = (uint32_t)syscall(SYS_gettid);
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    r = &buf[nbuf++];
+    r->time = (uint64_t)(now.tv_sec - start.tv_sec) * 1000000000 +
+	now.tv_nsec - start.tv_nsec;
+    r->ptr = (uintptr_t)ptr;
+    r->old = old;
+    r->size = size;
+    r->tid = tid;
+    r->type = type;
+    if (nbuf == BUFRECS)
+	flush();
+}
+
+/*
+ * log_call - append one record to the log
+ */
+static void log_call(uint32_t type, void *ptr, uint64_t old, size_t size)
+{
+    if (log_fd < 0)
+	return;
+    pthread_mutex_lock(&log_lock);
+    record(type, ptr, old, size);
+    pthread_mutex_unlock(&log_lock);
+}
+
+/*
+ * log_path - expand the %p's in pattern into path, which holds n bytes
+ */
+static void log_path(char *path, size_t n, const char *pattern)
+{
+    char pid[24];
+    size_t i = 0, j;
+    long v = (long)getpid();
+    int k = sizeof(pid);
+
+    do {
+	pid[--k] = '0' + v % 10;
+	v /= 10;
+    } while (v > 0);
+
+    for (; *pattern != '\0' && i < n - 1; pattern++) {
+	if (pattern[0] == '%' && pattern[1] == 'p') {
+	    for (j = k; j < sizeof(pid) && i < n - 1; j++)
+		path[i++] = pid[j];
+	    pattern++;
+	}
+	else
+	    path[i++] = *pattern;
+    }
+    path[i] = '\0';
+}
+
+/* Fork handlers: hold the lock across fork, and keep the child off the parent's log */
+static void fork_prepare(void)
+{
+    pthread_mutex_lock(&log_lock);
+    flush();
+}
+
+static void fork_parent(void)
+{
+    pthread_mutex_unlock(&log_lock);
+}
+
+static void fork_child(void)
+{
+    if (log_fd >= 0)
+	close(log_fd);
+    log_fd = -1;
+    tid = 0;
+    pthread_mutex_unlock(&log_lock);
+}
+
+/*
+ * mmtrace_init - open the log and write its header
+ */
+__attribute__((constructor))
+static void mmtrace_init(void)
+{
+    char path[4096];
+    const char *pattern = getenv("MMTRACE_LOG");
+    mmlog_hdr_t hdr;
+    int fd;
+
+    log_path(path, sizeof(path), pattern ? pattern : "mmtrace.%p.log");
+    if ((fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)) < 0)
+	return;
+
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, MMLOG_MAGIC, sizeof(hdr.magic));
+    hdr.version = MMLOG_VERSION;
+    hdr.recsize = sizeof(mmlog_rec_t);
+    log_fd = fd;
+    write_all(&hdr, sizeof(hdr));
+
+    pthread_atfork(fork_prepare, fork_parent, fork_child);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+}
+
+/*
+ * mmtrace_fini - write out what is left in the buffer at exit
+ */
+__attribute__((destructor))
+static void mmtrace_fini(void)
+{
+    pthread_mutex_lock(&log_lock);
+    flush();
+    if (log_fd >= 0)
+	close(log_fd);
+    log_fd = -1;
+    pthread_mutex_unlock(&log_lock);
+}
+
+/*
+ * The interposed calls
+ */
+void *malloc(size_t size)
+{
+    void *p = __libc_malloc(size);
+
+    if (p != NULL)
+	log_call(MMLOG_MALLOC, p, 0, size);
+    return p;
+}
+
+void *calloc(size_t nmemb, size_t size)
+{
+    void *p = __libc_calloc(nmemb, size);
+
+    if (p != NULL)
+	log_call(MMLOG_CALLOC, p, 0, nmemb * size);
+    return p;
+}
+
+/*
+ * realloc - the old block is released inside glibc, so the call runs
+ *     under log_lock: otherwise another thread could get the old address
+ *     back from malloc and log that before the realloc is logged
+ */
+void *realloc(void *ptr, size_t size)
+{
+    void *p;
+
+    if (ptr == NULL)
+	return malloc(size);
+    if (log_fd < 0)
+	return __libc_realloc(ptr, size);
+
+    pthread_mutex_lock(&log_lock);
+    p = __libc_realloc(ptr, size);
+    if (size == 0) {
+	if (p == NULL)
+	    record(MMLOG_FREE, ptr, 0, 0);
+	else /* glibc built to keep a minimum block for realloc(p, 0) */
+	    record(MMLOG_REALLOC, p, (uintptr_t)ptr, 1);
+    }
+    else if (p != NULL)
+	record(MMLOG_REALLOC, p, (uintptr_t)ptr, size);
+    pthread_mutex_unlock(&log_lock);
+    return p;
+}
+
+void *memalign(size_t align, size_t size)
+{
+    void *p = __libc_memalign(align, size);
+
+    if (p != NULL)
+	log_call(MMLOG_MEMALIGN, p, align, size);
+    return p;
+}
+
+void *aligned_alloc(size_t align, size_t size)
+{
+    return memalign(align, size);
+}
+
+int posix_memalign(void **memptr, size_t align, size_t size)
+{
+    void *p;
+
+    if (align % sizeof(void *) != 0 || (align & (align - 1)) != 0)
+	return EINVAL;
+    if ((p = memalign(align, size)) == NULL)
+	return ENOMEM;
+    *memptr = p;
+    return 0;
+}
+
+/*
+ * free - logged before the block is released, for the same reason as realloc
+ */
+void free(void *ptr)
+{
+    if (ptr == NULL)
+	return;
+    log_call(MMLOG_FREE, ptr, 0, 0);
+    __libc_free(ptr);
+}
@@ -0,0 +1,346 @@
+/*
+ * mtdriver.c - Multi-threaded stress driver for the malloc package in mm.c
+ *
+ * Runs the same random malloc/free workload on 1, 2, 4, ... up to N threads
+ * against an mm.c built with -DTHREADED=1 and reports the throughput for
+ * each thread count along with its speedup over one thread.  A share of
+ * the blocks are handed to other threads through a shared exchange array
+ * and freed there, so the cross-thread free path gets exercised too.
+ * Every payload starts with its size and is filled with a pattern that
+ * is checked when the block is freed.
+ *
+ * With -p the threads instead work in producer/consumer pairs: one
+ * thread of each pair only allocates and passes its blocks through a
+ * ring to the other, which only frees them.  Comparing an mm.c built
+ * with REMOTE_FREE=1 (mtdriver) against one built with REMOTE_FREE=0
+ * (mtdriver-locked) shows what the remote free queue buys over frees
+ * that take the owning arena's lock.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <sched.h>
+#include <pthread.h>
+
+#include "mm.h"
+#include "memlib.h"
+
+/* Misc */
+#define MAXTHREADS  256   /* largest thread count accepted by -t */
+#define XSLOTS     1024   /* entries in the shared exchange array */
+#define RINGSIZE    256   /* blocks in flight between a producer and its consumer */
+
+/* Parameters of one run, set from the command line */
+static int max_threads = 8;          /* -t: largest thread count */
+static long num_ops = 1000000;       /* -n: malloc+free pairs per thread */
+static int max_size = 256;           /* -s: largest request in bytes */
+static int num_slots = 1000;         /* -w: live blocks per thread */
+static int cross_pct = 10;           /* -x: percent of frees done by another thread */
+static int run_libc = 0;             /* -l: also run libc malloc */
+static int pairs = 0;                /* -p: producer/consumer pairs */
+
+/* The allocator under test */
+static void *(*malloc_fn)(size_t);
+static void (*free_fn)(void *);
+
+/* Blocks in transit between threads */
+static void *exchange[XSLOTS];
+
+/* Number of corrupted payloads seen */
+static long errors = 0;
+
+/* Single producer, single consumer ring shared by a pair of threads */
+typedef struct {
+    void *blocks[RINGSIZE];
+    unsigned long head;  /* next slot the producer fills */
+    unsigned long tail;  /* next slot the consumer empties */
+} ring_t;
+
+/* Per thread state */
+typedef struct {
+    int id;
+    uint64_t rng;        /* xorshift state, 64 bits on any host */
+    void **slots;        /* this thread's live blocks */
+    ring_t *ring;        /* -p: ring shared with the other thread of the pair */
+} worker_t;
+
+static uint64_t next_rand(uint64_t *state)
+{
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    return *state = x;
+}
+
+/*
+ * fill_block - record the size in the first word and fill the rest
+ *     with a byte derived from the address
+ */
+static void fill_block(void *p, size_t size)
+{
+    *(size_t *)p = size;
+    memset((char *)p + sizeof(size_t), (int)((uintptr_t)p >> 3),
+	   size - sizeof(size_t));
+}
+
+/*
+ * check_and_free - verify a block written by fill_block, then free it
+ */
+static void check_and_free(void *p)
+{
+    size_t size = *(size_t *)p;
+    unsigned char tag = (unsigned char)((uintptr_t)p >> 3);
+    unsigned char *c = (unsigned char *)p + sizeof(size_t);
+    size_t i;
+
+    for (i = 0; i < size - sizeof(size_t); i++) {
+	if (c[i] != tag) {
+	    __atomic_add_fetch(&errors, 1, __ATOMIC_RELAXED);
+	    break;
+	}
+    }
+    free_fn(p);
+}
+
+/*
+ * worker - one thread's share of the workload.  Each step picks one of
+ *     the thread's slots: an empty slot gets a new block, a full one
+ *     either frees its block or trades it for whatever block sits in a
+ *     random exchange slot (which was allocated by some other thread).
+ */
+static void *worker(void *arg)
+{
+    worker_t *w = (worker_t *)arg;
+    long i;
+
+    for (i = 0; i < 2 * num_ops; i++) {
+	uint64_t r = next_rand(&w->rng);
+	int slot = r % num_slots;
+	void *p = w->slots[slot];
+
+	if (p == NULL) {
+	    size_t size = sizeof(size_t) + (r >> 16) % (max_size - sizeof(size_t) + 1);
+	    if ((p = malloc_fn(size)) == NULL) {
+		fprintf(stderr, "thread %d: out of memory\n", w->id);
+		exit(1);
+	    }
+	    fill_block(p, size);
+	    w->slots[slot] = p;
+	}
+	else {
+	    w->slots[slot] = NULL;
+	    if ((int)((r >> 24) % 100) < cross_pct)
+		p = __atomic_exchange_n(&exchange[(r >> 32) % XSLOTS], p,
+					__ATOMIC_ACQ_REL);
+	    if (p != NULL)
+		check_and_free(p);
+	}
+    }
+    return NULL;
+}
+
+/*
+ * producer - allocate num_ops blocks and pass them to the consumer
+ */
+static void *producer(void *arg)
+{
+    worker_t *w = (worker_t *)arg;
+    ring_t *ring = w->ring;
+    long i;
+
+    for (i = 0; i < num_ops; i++) {
+	uint64_t r = next_rand(&w->rng);
+	size_t size = sizeof(size_t) + (r >> 16) % (max_size - sizeof(size_t) + 1);
+	void *p;
+
+	if ((p = malloc_fn(size)) == NULL) {
+	    fprintf(stderr, "thread %d: out of memory\n", w->id);
+	    exit(1);
+	}
+	fill_block(p, size);
+	while (ring->head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) == RINGSIZE)
+	    sched_yield();
+	ring->blocks[ring->head % RINGSIZE] = p;
+	__atomic_store_n(&ring->head, ring->head + 1, __ATOMIC_RELEASE);
+    }
+    return NULL;
+}
+
+/*
+ * consumer - free the num_ops blocks the producer passes along
+ */
+static void *consumer(void *arg)
+{
+    worker_t *w = (worker_t *)arg;
+    ring_t *ring = w->ring;
+    long i;
+
+    for (i = 0; i < num_ops; i++) {
+	while (__atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) == ring->tail)
+	    sched_yield();
+	check_and_free(ring->blocks[ring->tail % RINGSIZE]);
+	__atomic_store_n(&ring->tail, ring->tail + 1, __ATOMIC_RELEASE);
+    }
+    return NULL;
+}
+
+/*
+ * run - run the workload on nthreads threads and return the elapsed seconds
+ */
+static double run(int nthreads)
+{
+    pthread_t tids[MAXTHREADS];
+    worker_t workers[MAXTHREADS];
+    struct timespec start, end;
+    int i, j;
+
+    for (i = 0; i < nthreads; i++) {
+	workers[i].id = i;
+	workers[i].rng = UINT64_C(88172645463325252) + 7919 * i;
+	if ((workers[i].slots = calloc(num_slots, sizeof(void *))) == NULL ||
+	    (pairs && i % 2 == 0 && (workers[i].ring = calloc(1, sizeof(ring_t))) == NULL)) {
+	    fprintf(stderr, "calloc failed\n");
+	    exit(1);
+	}
+	if (pairs && i % 2 == 1)
+	    workers[i].ring = workers[i - 1].ring;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < nthreads; i++)
+	pthread_create(&tids[i], NULL,
+		       !pairs ? worker : (i % 2 == 0) ? producer : consumer,
+		       &workers[i]);
+    for (i = 0; i < nthreads; i++)
+	pthread_join(tids[i], NULL);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    /* Free whatever is still live so the next run starts from an empty heap */
+    for (i = 0; i < nthreads; i++) {
+	for (j = 0; j < num_slots; j++)
+	    if (workers[i].slots[j])
+		check_and_free(workers[i].slots[j]);
+	free(workers[i].slots);
+	if (pairs && i % 2 == 0)
+	    free(workers[i].ring);
+    }
+    for (j = 0; j < XSLOTS; j++) {
+	if (exchange[j]) {
+	    check_and_free(exchange[j]);
+	    exchange[j] = NULL;
+	}
+    }
+
+    return (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+/*
+ * scale - run the workload for 1, 2, 4, ... max_threads threads (2, 4,
+ *     ... with -p) and print a row per thread count
+ */
+static void scale(char *name, int reinit)
+{
+    double base = 0;
+    int t, first = pairs ? 2 : 1;
+
+    printf("\nResults for %s:\n", name);
+    printf("%8s%10s%12s%9s\n", "threads", "secs", "Kops/sec", "speedup");
+    for (t = first; ; t = (2 * t < max_threads) ? 2 * t : max_threads) {
+	double secs, ops, kops;
+
+	if (reinit) {
+	    mem_reset_brk();
+	    if (mm_init() < 0) {
+		fprintf(stderr, "mm_init failed\n");
+		exit(1);
+	    }
+	}
+	secs = run(t);
+	ops = (pairs ? 1.0 : 2.0) * num_ops * t;
+	kops = ops / secs / 1e3;
+	if (t == first)
+	    base = kops;
+	printf("%8d%10.3f%12.0f%8.2fx\n", t, secs, kops, kops / base);
+	if (t == max_threads)
+	    break;
+    }
+}
+
+static void usage(void)
+{
+    fprintf(stderr, "Usage: mtdriver [-hlp] [-t <threads>] [-n <ops>] [-s <size>] [-w <slots>] [-x <pct>]\n");
+    fprintf(stderr, "Options\n");
+    fprintf(stderr, "\t-h         Print this message.\n");
+    fprintf(stderr, "\t-l         Run libc malloc as well.\n");
+    fprintf(stderr, "\t-p         Run producer/consumer pairs instead.\n");
+    fprintf(stderr, "\t-t <n>     Scale from 1 up to n threads (default %d).\n", max_threads);
+    fprintf(stderr, "\t-n <n>     malloc/free pairs per thread (default %ld).\n", num_ops);
+    fprintf(stderr, "\t-s <n>     Largest request size in bytes (default %d).\n", max_size);
+    fprintf(stderr, "\t-w <n>     Live blocks per thread (default %d).\n", num_slots);
+    fprintf(stderr, "\t-x <n>     Percent of frees done by another thread (default %d).\n", cross_pct);
+}
+
+int main(int argc, char **argv)
+{
+    int c;
+
+    while ((c = getopt(argc, argv, "hlpt:n:s:w:x:")) != EOF) {
+	switch (c) {
+	case 'l':
+	    run_libc = 1;
+	    break;
+	case 'p':
+	    pairs = 1;
+	    break;
+	case 't':
+	    max_threads = atoi(optarg);
+	    break;
+	case 'n':
+	    num_ops = atol(optarg);
+	    break;
+	case 's':
+	    max_size = atoi(optarg);
+	    break;
+	case 'w':
+	    num_slots = atoi(optarg);
+	    break;
+	case 'x':
+	    cross_pct = atoi(optarg);
+	    break;
+	case 'h':
+	    usage();
+	    exit(0);
+	default:
+	    usage();
+	    exit(1);
+	}
+    }
+    if (pairs)
+	max_threads += max_threads % 2;
+    if (max_threads < 1 || max_threads > MAXTHREADS || num_slots < 1 ||
+	max_size < (int)sizeof(size_t)) {
+	usage();
+	exit(1);
+    }
+
+    if (run_libc) {
+	malloc_fn = malloc;
+	free_fn = free;
+	scale("libc malloc", 0);
+    }
+
+    mem_init();
+    malloc_fn = mm_malloc;
+    free_fn = mm_free;
+    scale("mm malloc", 1);
+
+    if (errors) {
+	printf("\nTerminated with %ld corrupted payloads\n", errors);
+	exit(1);
+    }
+    exit(0);
+}
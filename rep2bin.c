@@ -0,0 +1,106 @@
+/*
+ * rep2bin.c - Convert a .rep trace into the binary format of tracebin.h
+ *
+ *     rep2bin <in.rep> <out>
+ *
+ * The .rep file is parsed just as mdriver's read_trace parses it and
+ * checked the same way.  mdriver checks the ops again when it maps the
+ * result, since tracegen -B writes the format too.  mdriver tells the
+ * two formats apart by the magic number, so the output can have any name.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tracebin.h"
+
+#define MAXLINE 1024 /* max string size */
+
+static void usage(void)
+{
+    fprintf(stderr, "Usage: rep2bin <in.rep> <out>\n");
+}
+
+/*
+ * convert_error - report a malformed .rep file and remove the output
+ */
+static void convert_error(char *in, char *out, char *msg)
+{
+    fprintf(stderr, "rep2bin: %s: %s\n", in, msg);
+    remove(out);
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    FILE *infile, *outfile;
+    tracebin_hdr_t hdr;
+    traceop_t op;
+    char type[MAXLINE];
+    unsigned index, size;
+    unsigned max_index = 0;
+    int num_ops = 0;
+
+    if (argc != 3) {
+	usage();
+	exit(1);
+    }
+    if ((infile = fopen(argv[1], "r")) == NULL) {
+	perror(argv[1]);
+	exit(1);
+    }
+    if ((outfile = fopen(argv[2], "wb")) == NULL) {
+	perror(argv[2]);
+	exit(1);
+    }
+
+    /* The header of the .rep file becomes that of the binary trace */
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, TRACEBIN_MAGIC, sizeof(hdr.magic));
+    hdr.version = TRACEBIN_VERSION;
+    hdr.opsize = sizeof(traceop_t);
+    if (fscanf(infile, "%d %d %d %d", &hdr.sugg_heapsize, &hdr.num_ids,
+	       &hdr.num_ops, &hdr.weight) != 4)
+	convert_error(argv[1], argv[2], "bad header");
+    fwrite(&hdr, sizeof(hdr), 1, outfile);
+
+    /* Convert every request line */
+    while (fscanf(infile, "%1023s", type) != EOF) {   /* MAXLINE - 1 */
+	memset(&op, 0, sizeof(op));
+	switch (type[0]) {
+	case 'a':
+	case 'r':
+	    if (fscanf(infile, "%u %u", &index, &size) != 2)
+		convert_error(argv[1], argv[2], "bad request line");
+	    op.type = (type[0] == 'a') ? ALLOC : REALLOC;
+	    op.size = size;
+	    max_index = (index > max_index) ? index : max_index;
+	    break;
+	case 'f':
+	    if (fscanf(infile, "%u", &index) != 1)
+		convert_error(argv[1], argv[2], "bad request line");
+	    op.type = FREE;
+	    break;
+	default:
+	    sprintf(type, "bogus type character (%c)", type[0]);
+	    convert_error(argv[1], argv[2], type);
+	}
+	if (index >= (unsigned)hdr.num_ids)
+	    convert_error(argv[1], argv[2], "id out of range");
+	op.index = index;
+	fwrite(&op, sizeof(op), 1, outfile);
+	num_ops++;
+    }
+    fclose(infile);
+
+    if (num_ops != hdr.num_ops)
+	convert_error(argv[1], argv[2], "number of requests does not match the header");
+    if (max_index != (unsigned)hdr.num_ids - 1)
+	convert_error(argv[1], argv[2], "number of ids does not match the header");
+    if (fclose(outfile) != 0) {
+	perror(argv[2]);
+	remove(argv[2]);
+	exit(1);
+    }
+    exit(0);
+}
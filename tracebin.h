@@ -0,0 +1,34 @@
+/*
+ * tracebin.h - Binary trace format, written by rep2bin and mapped by mdriver
+ *
+ * A binary trace is a tracebin_hdr_t followed by num_ops traceop_t's, in
+ * the order of the lines of the .rep file it was converted from.  mdriver
+ * maps the file, checks the ops in one pass and uses them where they lie,
+ * so a trace of any size is ready without being parsed.  All fields are
+ * in the byte order of the machine that wrote the trace.
+ */
+#include <stdint.h>
+
+#define TRACEBIN_MAGIC   "MMTRACE\0"  /* first 8 bytes of every binary trace */
+#define TRACEBIN_VERSION 1
+
+/* Request types */
+enum {ALLOC, FREE, REALLOC};
+
+/* Characterizes a single trace operation (allocator request) */
+typedef struct {
+    int32_t type;         /* type of request */
+    int32_t index;        /* index for free() to use later */
+    int32_t size;         /* byte size of alloc/realloc request */
+} traceop_t;
+
+/* The header of a binary trace, which mirrors that of a .rep file */
+typedef struct {
+    char magic[8];        /* TRACEBIN_MAGIC */
+    uint32_t version;     /* TRACEBIN_VERSION */
+    uint32_t opsize;      /* sizeof(traceop_t) */
+    int32_t sugg_heapsize;/* suggested heap size (unused) */
+    int32_t num_ids;      /* number of alloc/realloc ids */
+    int32_t num_ops;      /* number of distinct requests */
+    int32_t weight;       /* weight for this trace (unused) */
+} tracebin_hdr_t;
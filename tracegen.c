@@ -0,0 +1,466 @@
+/*
+ * tracegen.c - Seeded generator of synthetic traces for mdriver
+ *
+ * Writes a trace of num_ops requests as a .rep file or, with -B, as a
+ * binary trace (tracebin.h).  The same seed and options always give the
+ * same trace.  Each step either reallocs a live block, frees one, or
+ * allocates a new one:
+ *
+ *   - Request sizes come from a distribution given with -z: fixed:N,
+ *     uniform:LO:HI, power:LO:HI:ALPHA (Pareto, capped at HI) or
+ *     bimodal:S1:S2:P (S1 with probability P, else S2).
+ *   - The block to free is picked by the lifetime policy given with -l:
+ *     lifo, fifo or random.  A share of blocks given with -k is long
+ *     lived instead: they stay allocated in the background until the
+ *     end of the trace.
+ *   - A share of steps given with -R reallocs a random live block, to
+ *     a size given by -g: geometric:F multiplies it by F, linear:N adds
+ *     N bytes, random draws a new size from the size distribution.
+ *   - The live bytes, background blocks included, never go past the
+ *     peak given with -p.  Below it, a step frees with the probability
+ *     given with -f and allocates otherwise; a step that would go past
+ *     the peak frees instead.  So the heap ramps up to about the peak
+ *     and then churns around it.  With only background blocks left to
+ *     free, the request is shrunk to fit, or dropped if nothing does,
+ *     and a realloc grows a block only as far as the peak allows.
+ *
+ * Whatever is live after num_ops requests is freed, newest first.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <math.h>
+
+#include "tracebin.h"
+
+/* Size distributions */
+enum {FIXED, UNIFORM, POWER, BIMODAL};
+
+/* Lifetime policies */
+enum {LIFO, FIFO, RANDOM};
+
+/* Realloc growth patterns */
+enum {GEOMETRIC, LINEAR, REDRAW};
+
+/* Parameters of the trace, set from the command line */
+static uint64_t seed = 1;            /* -s: seed of the generator */
+static long num_ops = 100000;        /* -n: requests before the final frees */
+static int size_dist = UNIFORM;      /* -z: size distribution... */
+static double size_a = 1, size_b = 1024, size_c = 0; /* ... and its parameters */
+static int lifetime = RANDOM;        /* -l: which block to free */
+static int keep_pct = 0;             /* -k: percent of blocks that live to the end */
+static int realloc_pct = 0;          /* -R: percent of steps that realloc */
+static int growth = GEOMETRIC;       /* -g: how a realloc resizes a block... */
+static double growth_arg = 2;        /* ... and by how much */
+static size_t peak = 1 << 20;        /* -p: peak live bytes */
+static int free_pct = 40;            /* -f: percent of steps below peak that free */
+static int binary = 0;               /* -B: write a binary trace */
+
+/* The trace being built */
+static traceop_t *ops;               /* requests */
+static long nops, maxops;            /* number of them, and room for */
+static int *sizes;                   /* current size of each id */
+static int nids;                     /* number of ids... */
+static long maxids;                  /* ... and room for */
+
+/* Ids of the live blocks that can be freed, oldest at head */
+static int *live;
+static long head, tail, maxlive;     /* live ids are live[head..tail) */
+static size_t live_bytes;            /* bytes live, background included */
+static size_t max_live_bytes;        /* most bytes ever live */
+
+/* Ids of the background blocks */
+static int *background;
+static long nbackground, maxbackground;
+
+static uint64_t rng;                 /* xorshift state, 64 bits on any host */
+
+static uint64_t next_rand(void)
+{
+    rng ^= rng << 13;
+    rng ^= rng >> 7;
+    rng ^= rng << 17;
+    return rng;
+}
+
+/* A uniform double in [0, 1) */
+static double next_unit(void)
+{
+    return (next_rand() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static void usage(void)
+{
+    fprintf(stderr, "Usage: tracegen [-hB] [-s <seed>] [-n <ops>] [-z <sizes>] [-l <policy>] [-k <pct>]\n");
+    fprintf(stderr, "                [-R <pct>] [-g <growth>] [-p <bytes>] [-f <pct>] [-o <file>]\n");
+    fprintf(stderr, "Options\n");
+    fprintf(stderr, "\t-h         Print this message.\n");
+    fprintf(stderr, "\t-B         Write a binary trace instead of a .rep file.\n");
+    fprintf(stderr, "\t-s <n>     Seed (default %" PRIu64 ").\n", seed);
+    fprintf(stderr, "\t-n <n>     Requests before the final frees (default %ld).\n", num_ops);
+    fprintf(stderr, "\t-z <dist>  fixed:N, uniform:LO:HI, power:LO:HI:ALPHA or bimodal:S1:S2:P\n");
+    fprintf(stderr, "\t           (default uniform:1:1024).\n");
+    fprintf(stderr, "\t-l <p>     Free lifo, fifo or random (default random).\n");
+    fprintf(stderr, "\t-k <n>     Percent of blocks that live to the end (default %d).\n", keep_pct);
+    fprintf(stderr, "\t-R <n>     Percent of requests that realloc (default %d).\n", realloc_pct);
+    fprintf(stderr, "\t-g <g>     Realloc to geometric:F, linear:N or random sizes\n");
+    fprintf(stderr, "\t           (default geometric:2).\n");
+    fprintf(stderr, "\t-p <n>     Cap on live bytes, with an optional K, M or G (default 1M).\n");
+    fprintf(stderr, "\t-f <n>     Percent of requests below the peak that free (default %d).\n", free_pct);
+    fprintf(stderr, "\t-o <file>  Write the trace to <file> (default stdout).\n");
+}
+
+static void bad_option(char *opt)
+{
+    fprintf(stderr, "tracegen: bad argument: %s\n", opt);
+    usage();
+    exit(1);
+}
+
+/*
+ * parse_sizes - parse the argument of -z
+ */
+static void parse_sizes(char *arg)
+{
+    int n;
+
+    size_c = 0;
+    if (sscanf(arg, "fixed:%lf%n", &size_a, &n) == 1 && arg[n] == '\0')
+	size_dist = FIXED;
+    else if (sscanf(arg, "uniform:%lf:%lf%n", &size_a, &size_b, &n) == 2 && arg[n] == '\0')
+	size_dist = UNIFORM;
+    else if (sscanf(arg, "power:%lf:%lf:%lf%n", &size_a, &size_b, &size_c, &n) == 3 &&
+	     arg[n] == '\0' && size_c > 0)
+	size_dist = POWER;
+    else if (sscanf(arg, "bimodal:%lf:%lf:%lf%n", &size_a, &size_b, &size_c, &n) == 3 &&
+	     arg[n] == '\0' && size_c >= 0 && size_c <= 1)
+	size_dist = BIMODAL;
+    else
+	bad_option(arg);
+    if (size_a < 1 || (size_dist != FIXED && size_b < size_a && size_dist != BIMODAL) ||
+	size_a > INT_MAX || size_b > INT_MAX)
+	bad_option(arg);
+}
+
+/*
+ * parse_growth - parse the argument of -g
+ */
+static void parse_growth(char *arg)
+{
+    int n;
+
+    if (sscanf(arg, "geometric:%lf%n", &growth_arg, &n) == 1 && arg[n] == '\0' &&
+	growth_arg > 0)
+	growth = GEOMETRIC;
+    else if (sscanf(arg, "linear:%lf%n", &growth_arg, &n) == 1 && arg[n] == '\0')
+	growth = LINEAR;
+    else if (strcmp(arg, "random") == 0)
+	growth = REDRAW;
+    else
+	bad_option(arg);
+}
+
+/*
+ * parse_bytes - parse a byte count with an optional K, M or G
+ */
+static size_t parse_bytes(char *arg)
+{
+    char *end;
+    double v = strtod(arg, &end);
+
+    switch (*end) {
+    case 'K': case 'k': v *= 1 << 10; end++; break;
+    case 'M': case 'm': v *= 1 << 20; end++; break;
+    case 'G': case 'g': v *= 1 << 30; end++; break;
+    }
+    if (*end != '\0' || v < 1)
+	bad_option(arg);
+    return (size_t)v;
+}
+
+/*
+ * clamp_size - round a size to a request mdriver can make
+ */
+static int clamp_size(double size)
+{
+    if (size < 1)
+	return 1;
+    if (size > INT_MAX)
+	return INT_MAX;
+    return (int)size;
+}
+
+/*
+ * draw_size - draw a request size from the size distribution
+ */
+static int draw_size(void)
+{
+    switch (size_dist) {
+    case FIXED:
+	return clamp_size(size_a);
+    case UNIFORM:
+	return clamp_size(size_a + (double)(next_rand() %
+					    (uint64_t)(size_b - size_a + 1)));
+    case POWER:
+	return clamp_size(fmin(size_a * pow(1 - next_unit(), -1 / size_c), size_b));
+    default: /* BIMODAL */
+	return clamp_size(next_unit() < size_c ? size_a : size_b);
+    }
+}
+
+/*
+ * grow_array - make room for one more element in *array, which holds
+ *     *max elements of size elsize
+ */
+static void grow_array(void *array, long used, long *max, size_t elsize)
+{
+    void **p = (void **)array;
+
+    if (used < *max)
+	return;
+    *max = *max ? 2 * *max : 1024;
+    if ((*p = realloc(*p, *max * elsize)) == NULL) {
+	fprintf(stderr, "tracegen: out of memory\n");
+	exit(1);
+    }
+}
+
+/*
+ * emit - append a request to the trace
+ */
+static void emit(int type, int index, int size)
+{
+    grow_array(&ops, nops, &maxops, sizeof(traceop_t));
+    ops[nops].type = type;
+    ops[nops].index = index;
+    ops[nops].size = size;
+    nops++;
+}
+
+/*
+ * do_alloc - allocate a block with a new id
+ */
+static void do_alloc(int size)
+{
+    int id = nids++;
+
+    grow_array(&sizes, id, &maxids, sizeof(int));
+    sizes[id] = size;
+    emit(ALLOC, id, size);
+    live_bytes += size;
+    if (live_bytes > max_live_bytes)
+	max_live_bytes = live_bytes;
+
+    if ((long)(next_rand() % 100) < keep_pct) {
+	grow_array(&background, nbackground, &maxbackground, sizeof(int));
+	background[nbackground++] = id;
+    }
+    else {
+	/* Slide the live ids down once the freed ones at the front pile up */
+	if (tail == maxlive && head > 0) {
+	    memmove(live, live + head, (tail - head) * sizeof(int));
+	    tail -= head;
+	    head = 0;
+	}
+	grow_array(&live, tail, &maxlive, sizeof(int));
+	live[tail++] = id;
+    }
+}
+
+/*
+ * do_free - free the live block the lifetime policy picks
+ */
+static void do_free(void)
+{
+    long i;
+    int id;
+
+    switch (lifetime) {
+    case LIFO:
+	id = live[--tail];
+	break;
+    case FIFO:
+	id = live[head++];
+	break;
+    default: /* RANDOM */
+	i = head + (long)(next_rand() % (uint64_t)(tail - head));
+	id = live[i];
+	live[i] = live[--tail];
+	break;
+    }
+    emit(FREE, id, 0);
+    live_bytes -= sizes[id];
+}
+
+/*
+ * do_realloc - resize a random live block by the growth pattern
+ */
+static void do_realloc(void)
+{
+    int id = live[head + (long)(next_rand() % (uint64_t)(tail - head))];
+    int size;
+
+    switch (growth) {
+    case GEOMETRIC:
+	size = clamp_size(sizes[id] * growth_arg);
+	break;
+    case LINEAR:
+	size = clamp_size(sizes[id] + growth_arg);
+	break;
+    default: /* REDRAW */
+	size = draw_size();
+	break;
+    }
+    if ((size_t)size > sizes[id] + (peak - live_bytes))   /* no further than the peak */
+	size = clamp_size((double)(sizes[id] + (peak - live_bytes)));
+    emit(REALLOC, id, size);
+    live_bytes += size - sizes[id];
+    sizes[id] = size;
+    if (live_bytes > max_live_bytes)
+	max_live_bytes = live_bytes;
+}
+
+/*
+ * write_trace - write the trace as a .rep file or a binary trace
+ */
+static void write_trace(FILE *f)
+{
+    tracebin_hdr_t hdr;
+    long i;
+
+    if (binary) {
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.magic, TRACEBIN_MAGIC, sizeof(hdr.magic));
+	hdr.version = TRACEBIN_VERSION;
+	hdr.opsize = sizeof(traceop_t);
+	hdr.sugg_heapsize = max_live_bytes > INT_MAX ? INT_MAX : (int)max_live_bytes;
+	hdr.num_ids = nids;
+	hdr.num_ops = nops;
+	hdr.weight = 1;
+	fwrite(&hdr, sizeof(hdr), 1, f);
+	fwrite(ops, sizeof(traceop_t), nops, f);
+	return;
+    }
+
+    fprintf(f, "%lu\n%d\n%ld\n1\n",
+	    max_live_bytes > INT_MAX ? INT_MAX : (unsigned long)max_live_bytes,
+	    nids, nops);
+    for (i = 0; i < nops; i++) {
+	switch (ops[i].type) {
+	case ALLOC:
+	    fprintf(f, "a %d %d\n", ops[i].index, ops[i].size);
+	    break;
+	case REALLOC:
+	    fprintf(f, "r %d %d\n", ops[i].index, ops[i].size);
+	    break;
+	default:
+	    fprintf(f, "f %d\n", ops[i].index);
+	    break;
+	}
+    }
+}
+
+int main(int argc, char **argv)
+{
+    char *outfile = NULL;
+    FILE *f = stdout;
+    long i;
+    int c, size;
+
+    while ((c = getopt(argc, argv, "hBs:n:z:l:k:R:g:p:f:o:")) != EOF) {
+	switch (c) {
+	case 'B':
+	    binary = 1;
+	    break;
+	case 's':
+	    seed = strtoull(optarg, NULL, 0);
+	    break;
+	case 'n':
+	    num_ops = atol(optarg);
+	    break;
+	case 'z':
+	    parse_sizes(optarg);
+	    break;
+	case 'l':
+	    if (strcmp(optarg, "lifo") == 0)
+		lifetime = LIFO;
+	    else if (strcmp(optarg, "fifo") == 0)
+		lifetime = FIFO;
+	    else if (strcmp(optarg, "random") == 0)
+		lifetime = RANDOM;
+	    else
+		bad_option(optarg);
+	    break;
+	case 'k':
+	    keep_pct = atoi(optarg);
+	    break;
+	case 'R':
+	    realloc_pct = atoi(optarg);
+	    break;
+	case 'g':
+	    parse_growth(optarg);
+	    break;
+	case 'p':
+	    peak = parse_bytes(optarg);
+	    break;
+	case 'f':
+	    free_pct = atoi(optarg);
+	    break;
+	case 'o':
+	    outfile = optarg;
+	    break;
+	case 'h':
+	    usage();
+	    exit(0);
+	default:
+	    usage();
+	    exit(1);
+	}
+    }
+    if (num_ops < 1 || keep_pct < 0 || keep_pct > 100 || realloc_pct < 0 ||
+	realloc_pct > 100 || free_pct < 0 || free_pct > 100) {
+	usage();
+	exit(1);
+    }
+
+    /* xorshift needs a nonzero state; mix the seed so nearby seeds differ */
+    rng = seed * UINT64_C(0x9e3779b97f4a7c15) + UINT64_C(0x2545f4914f6cdd1d);
+    if (rng == 0)
+	rng = 1;
+
+    for (i = 0; i < num_ops; i++) {
+	if (tail > head && (int)(next_rand() % 100) < realloc_pct) {
+	    do_realloc();
+	    continue;
+	}
+	size = draw_size();
+	if (tail > head &&
+	    (live_bytes + size > peak || (int)(next_rand() % 100) < free_pct))
+	    do_free();
+	else if (live_bytes < peak)   /* else only background blocks are live */
+	    do_alloc((size_t)size > peak - live_bytes ? (int)(peak - live_bytes) : size);
+    }
+
+    /* Free whatever is left, newest first */
+    lifetime = LIFO;
+    while (tail > head)
+	do_free();
+    while (nbackground > 0) {
+	emit(FREE, background[--nbackground], 0);
+	live_bytes -= sizes[ops[nops - 1].index];
+    }
+
+    if (outfile != NULL && (f = fopen(outfile, binary ? "wb" : "w")) == NULL) {
+	perror(outfile);
+	exit(1);
+    }
+    write_trace(f);
+    if (fclose(f) != 0) {
+	perror(outfile ? outfile : "stdout");
+	exit(1);
+    }
+    exit(0);
+}